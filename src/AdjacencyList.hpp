@@ -0,0 +1,167 @@
+#ifndef AdjacencyList_hpp
+#define AdjacencyList_hpp
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "algorithms/handle.hpp"
+
+/// Set of handles reachable from one node-side.
+/// Most node-sides have a handful of neighbors, so up to INLINE_CAPACITY
+/// handles are stored inside the object itself and searched linearly. Larger
+/// sets spill to a sorted heap array that is searched with a binary search.
+class AdjacencyList {
+    private:
+        static const uint32_t INLINE_CAPACITY = 4;
+
+        uint32_t count = 0;
+        uint32_t capacity = INLINE_CAPACITY;
+        union {
+            handle_t items[INLINE_CAPACITY];
+            handle_t* heap;
+        };
+
+        bool is_inline() const { return capacity == INLINE_CAPACITY; }
+
+        static bool less(const handle_t& a, const handle_t& b) {
+            return handlegraph::as_integer(a) < handlegraph::as_integer(b);
+        }
+
+        /// Position of the handle in a spilled (sorted) list
+        const handle_t* lower_bound(const handle_t& handle) const {
+            return std::lower_bound(heap, heap + count, handle, less);
+        }
+
+        void release() {
+            if (!is_inline()) delete[] heap;
+            count = 0;
+            capacity = INLINE_CAPACITY;
+        }
+
+        void copy_from(const AdjacencyList& other) {
+            count = other.count;
+            capacity = other.capacity;
+            if (other.is_inline()) {
+                std::copy(other.items, other.items + count, items);
+            } else {
+                heap = new handle_t[capacity];
+                std::copy(other.heap, other.heap + count, heap);
+            }
+        }
+
+        void move_from(AdjacencyList& other) {
+            count = other.count;
+            capacity = other.capacity;
+            if (other.is_inline()) {
+                std::copy(other.items, other.items + count, items);
+            } else {
+                heap = other.heap;
+            }
+            other.count = 0;
+            other.capacity = INLINE_CAPACITY;
+        }
+
+    public:
+        AdjacencyList() {}
+        AdjacencyList(const AdjacencyList& other) { copy_from(other); }
+        AdjacencyList(AdjacencyList&& other) noexcept { move_from(other); }
+        AdjacencyList& operator=(const AdjacencyList& other) {
+            if (this != &other) { release(); copy_from(other); }
+            return *this;
+        }
+        AdjacencyList& operator=(AdjacencyList&& other) noexcept {
+            if (this != &other) { release(); move_from(other); }
+            return *this;
+        }
+        ~AdjacencyList() { release(); }
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        /// Bytes allocated outside the object once the list has spilled
+        size_t heap_capacity() const { return is_inline() ? 0 : capacity * sizeof(handle_t); }
+
+        const handle_t* begin() const { return is_inline() ? items : heap; }
+        const handle_t* end() const { return begin() + count; }
+        const handle_t& operator[](size_t i) const { return begin()[i]; }
+
+        bool contains(const handle_t& handle) const {
+            if (is_inline()) return std::find(items, items + count, handle) != items + count;
+            const handle_t* it = lower_bound(handle);
+            return it != heap + count && *it == handle;
+        }
+
+        /// Returns true if the handle wasn't already in the list.
+        bool insert(const handle_t& handle) {
+            if (is_inline()) {
+                if (std::find(items, items + count, handle) != items + count) return false;
+                if (count < INLINE_CAPACITY) {
+                    items[count++] = handle;
+                    return true;
+                }
+                /// Spill to a sorted heap array
+                handle_t* spilled = new handle_t[2 * INLINE_CAPACITY];
+                std::copy(items, items + count, spilled);
+                std::sort(spilled, spilled + count, less);
+                heap = spilled;
+                capacity = 2 * INLINE_CAPACITY;
+            }
+
+            handle_t* pos = const_cast<handle_t*>(lower_bound(handle));
+            if (pos != heap + count && *pos == handle) return false;
+            size_t index = pos - heap;
+            if (count == capacity) {
+                handle_t* grown = new handle_t[2 * capacity];
+                std::copy(heap, heap + count, grown);
+                delete[] heap;
+                heap = grown;
+                capacity *= 2;
+            }
+            std::memmove(heap + index + 1, heap + index, (count - index) * sizeof(handle_t));
+            heap[index] = handle;
+            count++;
+            return true;
+        }
+
+        /// Returns true if the handle was in the list.
+        bool erase(const handle_t& handle) {
+            if (is_inline()) {
+                handle_t* it = std::find(items, items + count, handle);
+                if (it == items + count) return false;
+                *it = items[--count];
+                return true;
+            }
+
+            handle_t* pos = const_cast<handle_t*>(lower_bound(handle));
+            if (pos == heap + count || *pos != handle) return false;
+            std::memmove(pos, pos + 1, (heap + count - pos - 1) * sizeof(handle_t));
+            count--;
+
+            /// Move back inline once the list is comfortably small again
+            if (count <= INLINE_CAPACITY / 2) {
+                handle_t* spilled = heap;
+                std::copy(spilled, spilled + count, items);
+                delete[] spilled;
+                capacity = INLINE_CAPACITY;
+            }
+            return true;
+        }
+
+        /// Replaces the contents with a sorted range of distinct handles.
+        void assign(const handle_t* first, const handle_t* last) {
+            release();
+            count = last - first;
+            if (count > INLINE_CAPACITY) {
+                capacity = count;
+                heap = new handle_t[capacity];
+                std::copy(first, last, heap);
+            } else {
+                std::copy(first, last, items);
+            }
+        }
+
+        void clear() { release(); }
+};
+
+#endif /* AdjacencyList_hpp */
@@ -1,9 +1,20 @@
 #include "BidirectedGraph.hpp"
+#include "BidirectedGraphBuilder.hpp"
+#include "BidirectedGraphOverlay.hpp"
+#include "JsonGraphReader.hpp"
+#include "MappedBidirectedGraph.hpp"
 
-#include "../deps/jsoncpp/dist/json/json.h"
 #include "handlegraph/util.hpp"
+#include "ThreadPool.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
 using namespace std;
 
 //******************************************************************************
@@ -12,79 +23,483 @@ using namespace std;
 
 /// Deserializes vg JSON fromat
 /// Returns true if deserialize successfully or false if otherwise
-bool BidirectedGraph::deserialize(ifstream& infile) {
-    Json::CharReaderBuilder reader;
-    Json::Value graph_json;
-    string errs;
-    bool resp = Json::parseFromStream(reader, infile, &graph_json, &errs);
+bool BidirectedGraph::deserialize(ifstream& infile, LoadMode mode) {
+    /// Stream the nodes and edges into the builder as they are parsed, and
+    /// build the graph in one pass. Nothing is added if parsing fails.
+    BidirectedGraphBuilder builder(*this, mode == LoadMode::FULL);
+    JsonGraphReader reader(infile);
+    auto on_edge = [&](const nid_t& from, bool from_start, const nid_t& to, bool to_end) {
+        builder.add_edge(get_handle(from, from_start), get_handle(to, to_end));
+    };
+    bool resp;
+    if (mode == LoadMode::FULL) {
+        resp = reader.read([&](const nid_t& id, const string& sequence) {
+            builder.add_node(id, sequence);
+        }, on_edge);
+    } else {
+        /// Sequences are only scanned, never copied
+        resp = reader.read_lengths([&](const nid_t& id, size_t length) {
+            builder.add_node_length(id, mode == LoadMode::LENGTHS_ONLY ? length : 0);
+        }, on_edge);
+    }
 
     /// If file not in json format, print error and return false
     if (!resp) {
-        cerr << "Error: Parse failed" << endl << errs << endl;
+        cerr << "Error: Parse failed" << endl << reader.error() << endl;
         return false;
     }
 
-    /// TODO: check if it's proper vg JSON format
+    builder.finalize();
+    return true;
+}
+
+bool BidirectedGraph::has_sequences() const {
+    return arena.has_bases();
+}
 
-    /// Construct nodes
-    Json::Value nodes = graph_json["node"];
-    for (auto& node : nodes) {
-        nid_t id1 = stoll(node["id"].asString());
-        string sequence = node["sequence"].asString();
-        create_handle(sequence, id1);
+bool BidirectedGraph::serialize(ofstream& outfile, bool sort_by_id) {
+    vector<size_t> order = get_slot_order();
+    if (sort_by_id) {
+        sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return get_slot_id(a) < get_slot_id(b);
+        });
     }
+    return write_json(outfile, order);
+}
+
+bool BidirectedGraph::serialize(ofstream& outfile, const vector<handle_t>& order) {
+    vector<size_t> slots;
+    slots.reserve(summary.node_count);
+    vector<bool> listed(present.size(), false);
+    for (const auto& handle : order) {
+        size_t slot = get_slot(get_id(handle));
+        if (slot == NO_SLOT || listed[slot]) continue;
+        listed[slot] = true;
+        slots.push_back(slot);
+    }
+    for (size_t slot : get_slot_order()) {
+        if (!listed[slot]) slots.push_back(slot);
+    }
+    return write_json(outfile, slots);
+}
+
+bool BidirectedGraph::deserialize_gfa(ifstream& infile, LoadMode mode) {
+    BidirectedGraphBuilder builder(*this, mode == LoadMode::FULL);
+    vector<string> paths;
 
-    /// Construct edges
-    Json::Value edges = graph_json["edge"];
-    for (auto& edge : edges) {
-        nid_t id1 = stoll(edge["from"].asString());
-        nid_t id2 = stoll(edge["to"].asString());
-        bool from_left = edge.get("from_start", false).asBool();
-        bool to_right = edge.get("to_end", false).asBool();
-        create_edge(get_handle(id1, from_left), get_handle(id2, to_right));
+    string line;
+    vector<string_view> fields;
+    size_t line_number = 0;
+    auto fail = [&](const string& message) {
+        cerr << "Error: Parse failed" << endl << "Line " << line_number << ": " << message << endl;
+        return false;
+    };
+    auto parse_id = [&](const string_view& field, nid_t& id) {
+        string name(field);
+        char* rest;
+        id = strtoll(name.c_str(), &rest, 10);
+        return !name.empty() && *rest == '\0';
+    };
+    auto parse_orientation = [&](const string_view& field, bool& is_reverse) {
+        is_reverse = field == "-";
+        return field == "+" || field == "-";
+    };
+
+    while (getline(infile, line)) {
+        line_number++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.size() < 2 || line[1] != '\t') continue;
+
+        if (line[0] == 'P' || line[0] == 'W') {
+            paths.push_back(line);
+            continue;
+        }
+        if (line[0] != 'S' && line[0] != 'L') continue;
+
+        /// Split the record into its tab-separated fields
+        fields.clear();
+        size_t start = 0;
+        while (true) {
+            size_t tab = line.find('\t', start);
+            fields.emplace_back(line.data() + start, (tab == string::npos ? line.size() : tab) - start);
+            if (tab == string::npos) break;
+            start = tab + 1;
+        }
+
+        if (line[0] == 'S') {
+            nid_t id;
+            if (fields.size() < 3) return fail("S line needs a name and a sequence");
+            if (!parse_id(fields[1], id)) return fail("segment name '" + string(fields[1]) + "' isn't an integer ID");
+            if (mode == LoadMode::FULL) {
+                builder.add_node(id, fields[2] == "*" ? string() : string(fields[2]));
+            } else if (mode == LoadMode::LENGTHS_ONLY) {
+                /// A segment without its sequence may still give its length
+                size_t length = fields[2] == "*" ? 0 : fields[2].size();
+                for (size_t i = 3; i < fields.size() && fields[2] == "*"; i++) {
+                    if (fields[i].substr(0, 5) != "LN:i:") continue;
+                    length = strtoull(string(fields[i].substr(5)).c_str(), nullptr, 10);
+                }
+                builder.add_node_length(id, length);
+            } else {
+                builder.add_node_length(id, 0);
+            }
+        } else {
+            nid_t from, to;
+            bool from_reverse, to_reverse;
+            if (fields.size() < 5) return fail("L line needs two segments and their orientations");
+            if (!parse_id(fields[1], from) || !parse_id(fields[3], to)) return fail("link to a segment without an integer ID");
+            if (!parse_orientation(fields[2], from_reverse) || !parse_orientation(fields[4], to_reverse)) {
+                return fail("orientation isn't '+' or '-'");
+            }
+            if (fields.size() > 5 && !fields[5].empty() && fields[5] != "*" && fields[5] != "0M") {
+                return fail("overlap '" + string(fields[5]) + "' isn't supported, only blunt links are");
+            }
+            builder.add_edge(get_handle(from, from_reverse), get_handle(to, to_reverse));
+        }
     }
+    builder.finalize();
+
+    /// Building into an empty graph clears it, so the paths go in afterwards
+    gfa_paths.insert(gfa_paths.end(), make_move_iterator(paths.begin()), make_move_iterator(paths.end()));
     return true;
 }
 
-bool BidirectedGraph::serialize(ofstream& outfile) {
-    function<void(Json::Value&, const nid_t&, const string&)> create_node = 
-        [&](Json::Value& node, const nid_t& nid, const string& sequence) {
-            node["id"] = nid;
-            node["sequence"] = sequence;
-        };
-    function<void(Json::Value&, const handle_t&, const handle_t&)> create_edge = 
-        [&](Json::Value& node, const handle_t& from, const handle_t& to) {
-            node["from"] = get_id(from);
-            node["to"] = get_id(to);
-            if (get_is_reverse(from)) node["from_start"] = true;
-            if (get_is_reverse(to)) node["to_end"] = true;
-        };
-
-    Json::Value graph_json;
-    Json::Value graph_nodes(Json::arrayValue);
-    for (const auto& [nid, sequence] : nodes) {
-        Json::Value node;
-        create_node(node, nid, sequence);
-        graph_nodes.append(node);
-    }
-
-    Json::Value graph_edges(Json::arrayValue);
-    for (const auto& [from, to_set] : edges) {
-        for (const auto& to : to_set) {
-            if (get_id(from) <= get_id(to)) {
-                Json::Value edge;
-                create_edge(edge, from, to);
-                graph_edges.append(edge);
+bool BidirectedGraph::serialize_gfa(ofstream& outfile) {
+    outfile << "H\tVN:Z:1.0\n";
+
+    string sequence;
+    for (size_t slot = 0; slot < present.size(); slot++) {
+        if (!present[slot]) continue;
+        if (!arena.has_bases()) {
+            outfile << "S\t" << get_slot_id(slot) << "\t*\tLN:i:" << spans[slot].length << '\n';
+            continue;
+        }
+        arena.decode(spans[slot], false, sequence);
+        outfile << "S\t" << get_slot_id(slot) << '\t' << (sequence.empty() ? "*" : sequence) << '\n';
+    }
+
+    /// Each edge is stored from both of its sides (once for inversions), so
+    /// only its canonical orientation is written
+    for (size_t side = 0; side < adjacency.size(); side++) {
+        if (!present[side / 2]) continue;
+        handle_t from = get_handle(get_slot_id(side / 2), side % 2);
+        for (const auto& to : adjacency[side]) {
+            if (edge_handle(from, to) != edge_t(from, to)) continue;
+            outfile << "L\t" << get_id(from) << '\t' << (get_is_reverse(from) ? '-' : '+') << '\t'
+                << get_id(to) << '\t' << (get_is_reverse(to) ? '-' : '+') << "\t0M\n";
+        }
+    }
+
+    for (const auto& path : gfa_paths) {
+        outfile << path << '\n';
+    }
+    outfile.flush();
+    return static_cast<bool>(outfile);
+}
+
+bool BidirectedGraph::serialize_binary(ofstream& outfile) {
+    return MappedBidirectedGraph::write(*this, outfile);
+}
+
+bool BidirectedGraph::write_json(ofstream& outfile, const vector<size_t>& order) const {
+    /// Output is assembled in a buffer and written out a block at a time
+    string buffer;
+    auto flush = [&](size_t limit) {
+        if (buffer.size() < limit) return;
+        outfile.write(buffer.data(), buffer.size());
+        buffer.clear();
+    };
+    auto append_number = [&](const nid_t& value) {
+        char digits[24];
+        buffer.append(digits, to_chars(digits, digits + sizeof(digits), value).ptr);
+    };
+
+    string sequence;
+    buffer += "{\n\"node\": [";
+    bool is_first = true;
+    for (size_t slot : order) {
+        arena.decode(spans[slot], false, sequence);
+        buffer += is_first ? "\n" : ",\n";
+        buffer += "{\"id\": ";
+        append_number(get_slot_id(slot));
+        buffer += ", \"sequence\": \"";
+        for (char base : sequence) {
+            if (static_cast<unsigned char>(base) < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", base);
+                buffer += escaped;
+                continue;
             }
+            if (base == '"' || base == '\\') buffer += '\\';
+            buffer += base;
         }
+        buffer += "\"}";
+        is_first = false;
+        flush(1 << 16);
     }
 
-    graph_json["edge"] = graph_edges;
-    graph_json["node"] = graph_nodes;
+    /// Each edge is stored from both of its sides (once for inversions), so
+    /// only its canonical orientation is written. Neighbors are sorted so the
+    /// output doesn't depend on the order edges were added in.
+    buffer += "\n],\n\"edge\": [";
+    is_first = true;
+    vector<handle_t> targets;
+    for (size_t slot : order) {
+        for (bool is_reverse : {false, true}) {
+            handle_t from = get_handle(get_slot_id(slot), is_reverse);
+            const AdjacencyList& neighbors = adjacency[2 * slot + is_reverse];
+            targets.assign(neighbors.begin(), neighbors.end());
+            sort(targets.begin(), targets.end(), [](const handle_t& a, const handle_t& b) {
+                return as_integer(a) < as_integer(b);
+            });
+            for (const auto& to : targets) {
+                if (edge_handle(from, to) != edge_t(from, to)) continue;
+                buffer += is_first ? "\n" : ",\n";
+                buffer += "{\"from\": ";
+                append_number(get_id(from));
+                buffer += ", \"to\": ";
+                append_number(get_id(to));
+                if (get_is_reverse(from)) buffer += ", \"from_start\": true";
+                if (get_is_reverse(to)) buffer += ", \"to_end\": true";
+                buffer += "}";
+                is_first = false;
+            }
+            flush(1 << 16);
+        }
+    }
+    buffer += "\n]\n}\n";
+    flush(0);
+    outfile.flush();
+    return static_cast<bool>(outfile);
+}
+
+//******************************************************************************
+// Node storage functions
+//******************************************************************************
 
-    outfile << graph_json << endl;
+size_t BidirectedGraph::get_slot(const nid_t& node_id) const {
+    size_t slot;
+    if (is_dense) {
+        if (node_id < id_base) return NO_SLOT;
+        slot = node_id - id_base;
+        if (slot >= present.size()) return NO_SLOT;
+    } else {
+        auto it = sparse_slots.find(node_id);
+        if (it == sparse_slots.end()) return NO_SLOT;
+        slot = it->second;
+    }
+    return present[slot] ? slot : NO_SLOT;
+}
 
-    return true;
+nid_t BidirectedGraph::get_slot_id(size_t slot) const {
+    return is_dense ? id_base + static_cast<nid_t>(slot) : slot_ids[slot];
+}
+
+bool BidirectedGraph::is_compact(size_t range, size_t count) {
+    return range <= DENSE_FACTOR * count + DENSE_SLACK;
+}
+
+size_t BidirectedGraph::add_slot(const nid_t& node_id) {
+    if (is_dense) {
+        /// The first node decides where the range starts
+        if (present.empty()) id_base = node_id;
+
+        nid_t lo = min(node_id, id_base);
+        nid_t hi = max(node_id, id_base + static_cast<nid_t>(present.size()) - 1);
+        if (is_compact(static_cast<size_t>(hi - lo) + 1, summary.node_count + 1)) {
+            resize_dense(lo, hi);
+            return node_id - id_base;
+        }
+        make_sparse();
+    }
+
+    /// Hashed lookup: reuse the node's slot if it has one, otherwise append
+    auto it = sparse_slots.find(node_id);
+    if (it != sparse_slots.end()) return it->second;
+    size_t slot = present.size();
+    sparse_slots[node_id] = slot;
+    slot_ids.push_back(node_id);
+    present.push_back(false);
+    spans.emplace_back();
+    adjacency.resize(2 * present.size());
+    return slot;
+}
+
+void BidirectedGraph::resize_dense(const nid_t& lo, const nid_t& hi) {
+    /// Shift existing slots up to make room in front of the range
+    if (lo < id_base) {
+        size_t shift = id_base - lo;
+        present.insert(present.begin(), shift, false);
+        spans.insert(spans.begin(), shift, SequenceSpan());
+        adjacency.insert(adjacency.begin(), 2 * shift, AdjacencyList());
+        id_base = lo;
+    }
+    size_t size = static_cast<size_t>(hi - id_base) + 1;
+    if (size > present.size()) {
+        present.resize(size, false);
+        spans.resize(size);
+        adjacency.resize(2 * size);
+    }
+}
+
+void BidirectedGraph::make_sparse() {
+    if (!is_dense) return;
+    slot_ids.resize(present.size());
+    sparse_slots.reserve(summary.node_count);
+    for (size_t slot = 0; slot < present.size(); slot++) {
+        slot_ids[slot] = id_base + static_cast<nid_t>(slot);
+        if (present[slot]) sparse_slots[slot_ids[slot]] = slot;
+    }
+    is_dense = false;
+}
+
+void BidirectedGraph::reserve_ids(const nid_t& min_id, const nid_t& max_id, size_t count) {
+    if (is_dense) {
+        /// Nothing stored yet so the range can start anywhere
+        if (summary.node_count == 0) {
+            present.clear();
+            spans.clear();
+            adjacency.clear();
+        }
+        if (present.empty()) id_base = min_id;
+
+        nid_t lo = min(min_id, id_base);
+        nid_t hi = max(max_id, id_base + static_cast<nid_t>(present.size()) - 1);
+        if (is_compact(static_cast<size_t>(hi - lo) + 1, summary.node_count + count)) {
+            resize_dense(lo, hi);
+            return;
+        }
+        make_sparse();
+    }
+    sparse_slots.reserve(summary.node_count + count);
+    slot_ids.reserve(slot_ids.size() + count);
+    present.reserve(present.size() + count);
+    spans.reserve(spans.size() + count);
+    adjacency.reserve(adjacency.size() + 2 * count);
+}
+
+vector<size_t> BidirectedGraph::get_slot_order() const {
+    vector<size_t> order;
+    order.reserve(summary.node_count);
+    for (size_t slot = 0; slot < present.size(); slot++) {
+        if (present[slot]) order.push_back(slot);
+    }
+    return order;
+}
+
+void BidirectedGraph::rebuild(const vector<size_t>& order, const vector<nid_t>& new_ids) {
+    /// Nodes can keep ID-indexed slots only if the order is by ascending ID
+    bool ascending = true;
+    for (size_t i = 1; i < order.size() && ascending; i++) {
+        ascending = new_ids[order[i - 1]] < new_ids[order[i]];
+    }
+    nid_t lo = order.empty() ? 0 : new_ids[order.front()];
+    nid_t hi = order.empty() ? -1 : new_ids[order.back()];
+    bool dense = order.empty() ||
+        (ascending && is_compact(static_cast<size_t>(hi - lo) + 1, order.size()));
+    size_t size = dense ? static_cast<size_t>(hi - lo + 1) : order.size();
+
+    unordered_map<nid_t, size_t> new_sparse_slots;
+    vector<nid_t> new_slot_ids;
+    vector<bool> new_present(size, false);
+    vector<SequenceSpan> new_spans(size);
+    vector<AdjacencyList> new_adjacency(2 * size);
+    SequenceArena new_arena(arena.has_bases());
+    new_arena.reserve(arena.size() - arena.unused_size());
+    if (!dense) {
+        new_sparse_slots.reserve(order.size());
+        new_slot_ids.resize(size);
+    }
+
+    for (size_t i = 0; i < order.size(); i++) {
+        size_t old_slot = order[i];
+        nid_t id = new_ids[old_slot];
+        size_t slot = dense ? static_cast<size_t>(id - lo) : i;
+        if (!dense) {
+            new_sparse_slots[id] = slot;
+            new_slot_ids[slot] = id;
+        }
+        new_present[slot] = true;
+        new_spans[slot] = new_arena.append(arena, spans[old_slot]);
+
+        /// Rename the neighbors to their new IDs
+        for (size_t r = 0; r < 2; r++) {
+            AdjacencyList& neighbors = new_adjacency[2 * slot + r];
+            for (const auto& handle : adjacency[2 * old_slot + r]) {
+                size_t neighbor_slot = get_slot(get_id(handle));
+                neighbors.insert(get_handle(new_ids[neighbor_slot], get_is_reverse(handle)));
+            }
+        }
+    }
+
+    is_dense = dense;
+    id_base = dense ? lo : 0;
+    sparse_slots = move(new_sparse_slots);
+    slot_ids = move(new_slot_ids);
+    present = move(new_present);
+    spans = move(new_spans);
+    adjacency = move(new_adjacency);
+    arena = move(new_arena);
+    stale_bounds = false;
+    compact_size = size;
+    for (size_t i = 0; i < order.size(); i++) {
+        nid_t id = new_ids[order[i]];
+        if (i == 0 || id < summary.min_id) summary.min_id = id;
+        if (i == 0 || id > summary.max_id) summary.max_id = id;
+        cur_id = max(cur_id, id + 1);
+    }
+}
+
+//******************************************************************************
+// Summary statistics functions
+//******************************************************************************
+
+void BidirectedGraph::count_degree(size_t old_degree, size_t new_degree) {
+    vector<size_t>& histogram = summary.degree_histogram;
+    if (new_degree >= histogram.size()) histogram.resize(new_degree + 1, 0);
+    histogram[new_degree]++;
+    uncount_degree(old_degree);
+}
+
+void BidirectedGraph::uncount_degree(size_t degree) {
+    vector<size_t>& histogram = summary.degree_histogram;
+    histogram[degree]--;
+    while (!histogram.empty() && histogram.back() == 0) histogram.pop_back();
+}
+
+thread_local size_t BidirectedGraph::walk_depth = 0;
+
+bool BidirectedGraph::needs_compaction() const {
+    /// Only count slots added since the last layout, so a dense range that is
+    /// sparse by nature isn't compacted over and over
+    size_t dead = present.size() - summary.node_count;
+    bool slots = dead > summary.node_count + COMPACT_SLACK && present.size() > 2 * compact_size;
+    bool bases = arena.unused_size() > COMPACT_BASES && 2 * arena.unused_size() > arena.size();
+    return slots || bases;
+}
+
+void BidirectedGraph::update_bounds() const {
+    if (!stale_bounds) return;
+    stale_bounds = false;
+    bool found = false;
+    for (const auto& [nid, slot] : sparse_slots) {
+        if (!present[slot]) continue;
+        if (!found || nid < summary.min_id) summary.min_id = nid;
+        if (!found || nid > summary.max_id) summary.max_id = nid;
+        found = true;
+    }
+}
+
+AdjacencyList* BidirectedGraph::get_adjacency(const handle_t& handle) {
+    size_t slot = get_slot(get_id(handle));
+    if (slot == NO_SLOT) return nullptr;
+    return &adjacency[2 * slot + get_is_reverse(handle)];
+}
+
+const AdjacencyList* BidirectedGraph::get_adjacency(const handle_t& handle) const {
+    size_t slot = get_slot(get_id(handle));
+    if (slot == NO_SLOT) return nullptr;
+    return &adjacency[2 * slot + get_is_reverse(handle)];
 }
 
 //******************************************************************************
@@ -93,7 +508,7 @@ bool BidirectedGraph::serialize(ofstream& outfile) {
 
 /// Method to check if a node exists by ID
 bool BidirectedGraph::has_node(nid_t nodeid) const {
-    return nodes.count(nodeid);
+    return get_slot(nodeid) != NO_SLOT;
 }
 
 /// Look up the handle for the node with the given ID in the given orientation
@@ -118,46 +533,123 @@ handle_t BidirectedGraph::flip(const handle_t& handle) const {
 
 /// Get the length of a node
 size_t BidirectedGraph::get_length(const handle_t& handle) const {
-    return get_sequence(handle).size();
+    size_t slot = get_slot(get_id(handle));
+    if (slot == NO_SLOT) throw out_of_range("BidirectedGraph: no such node");
+    return spans[slot].length;
 }
 
 /// Get the sequence of a node, presented in the handle's local forward
 /// orientation.
 string BidirectedGraph::get_sequence(const handle_t& handle) const {
-    return nodes.at(get_id(handle));
+    string sequence;
+    get_sequence(handle, sequence);
+    return sequence;
+}
+
+/// Decode the sequence of a node into the given buffer, presented in the
+/// handle's local forward orientation.
+void BidirectedGraph::get_sequence(const handle_t& handle, string& buffer) const {
+    get_sequence_view(handle).decode(buffer);
+}
+
+/// Get a single base of a node in the handle's local forward orientation.
+char BidirectedGraph::get_base(const handle_t& handle, size_t index) const {
+    return get_sequence_view(handle)[index];
+}
+
+/// Get a substring of a node's sequence in the handle's local forward
+/// orientation.
+string BidirectedGraph::get_subsequence(const handle_t& handle, size_t index, size_t size) const {
+    return get_sequence_view(handle).substr(index, size).str();
+}
+
+/// Get a view of a node's sequence in the handle's local forward orientation.
+SequenceView BidirectedGraph::get_sequence_view(const handle_t& handle) const {
+    size_t slot = get_slot(get_id(handle));
+    if (slot == NO_SLOT) throw out_of_range("BidirectedGraph: no such node");
+    return arena.view(spans[slot], get_is_reverse(handle));
+}
+
+bool BidirectedGraph::for_each_sequence(const function<bool(const handle_t&, const SequenceView&)>& iteratee) const {
+    WalkGuard guard;
+    for (size_t slot = 0; slot < present.size(); slot++) {
+        if (!present[slot]) continue;
+        if (!iteratee(get_handle(get_slot_id(slot)), arena.view(spans[slot], false))) return false;
+    }
+    return true;
 }
 
 /// Return the number of nodes in the graph
 size_t BidirectedGraph::get_node_count() const {
-    return nodes.size();
+    return summary.node_count;
 }
 
 /// Return the smallest ID in the graph, or some smaller number if the
 /// smallest ID is unavailable. Return value is unspecified if the graph is empty.
 nid_t BidirectedGraph::min_node_id() const {
-    auto res = min_element(nodes.begin(), nodes.end(),
-        [] (const auto& n1, const auto& n2) {
-            return n1.first < n2.first;
-        }
-    );
-    if (res != nodes.end()) {
-        return res->first;   
-    }
-    return 0;
+    update_bounds();
+    return summary.node_count ? summary.min_id : 0;
 }
 
 /// Return the largest ID in the graph, or some larger number if the
 /// largest ID is unavailable. Return value is unspecified if the graph is empty.
 nid_t BidirectedGraph::max_node_id() const {
-    auto res = max_element(nodes.begin(), nodes.end(),
-        [](const auto& n1, const auto& n2) {
-            return n1.first < n2.first;
-        }
-    );
-    if (res != nodes.end()) {
-        return res->first;
+    update_bounds();
+    return summary.node_count ? summary.max_id : 0;
+}
+
+size_t BidirectedGraph::get_degree(const handle_t& handle, bool go_left) const {
+    const AdjacencyList* neighbors = get_adjacency(go_left ? flip(handle) : handle);
+    return neighbors == nullptr ? 0 : neighbors->size();
+}
+
+bool BidirectedGraph::has_edge(const handle_t& left, const handle_t& right) const {
+    const AdjacencyList* neighbors = get_adjacency(left);
+    return neighbors != nullptr && neighbors->contains(right);
+}
+
+size_t BidirectedGraph::get_edge_count() const {
+    return summary.edge_count;
+}
+
+size_t BidirectedGraph::get_total_length() const {
+    return summary.total_length;
+}
+
+const GraphStats& BidirectedGraph::stats() const {
+    update_bounds();
+    return summary;
+}
+
+BidirectedGraphOverlay BidirectedGraph::snapshot() const {
+    return BidirectedGraphOverlay(*this);
+}
+
+MemoryUsage BidirectedGraph::memory_usage() const {
+    MemoryUsage usage("BidirectedGraph", sizeof(BidirectedGraph));
+    usage.add("sparse_slots", MemoryUsage::of_table(sparse_slots));
+    usage.add("slot_ids", MemoryUsage::of(slot_ids));
+    usage.add("present", MemoryUsage::of(present));
+    usage.add("spans", MemoryUsage::of(spans));
+    usage.add(arena.memory_usage());
+
+    /// Lists with more neighbors than fit inline hold a heap array each
+    MemoryUsage& lists = usage.add("adjacency", MemoryUsage::of(adjacency));
+    size_t spilled = 0;
+    for (const auto& neighbors : adjacency) {
+        if (neighbors.heap_capacity()) spilled += MemoryUsage::heap_block(neighbors.heap_capacity());
     }
-    return 0;
+    lists.add("spilled", spilled);
+
+    usage.add("degree_histogram", MemoryUsage::of(summary.degree_histogram));
+
+    MemoryUsage& paths = usage.add("gfa_paths", MemoryUsage::of(gfa_paths));
+    size_t path_bytes = 0;
+    for (const auto& path : gfa_paths) {
+        if (path.capacity() > 15) path_bytes += MemoryUsage::heap_block(path.capacity() + 1);
+    }
+    paths.add("lines", path_bytes);
+    return usage;
 }
 
 //******************************************************************************
@@ -165,28 +657,57 @@ nid_t BidirectedGraph::max_node_id() const {
 //******************************************************************************
 
 handle_t BidirectedGraph::create_handle(const string& sequence) {
-    nodes[cur_id] = sequence;
-    cur_id++; /// Increment node id
-    return get_handle(cur_id - 1);
+    /// Pass a copy: create_handle advances cur_id before returning the handle
+    nid_t id = cur_id;
+    return create_handle(sequence, id);
 }
 
 handle_t BidirectedGraph::create_handle(const string& sequence, const nid_t& id) {
-    nodes[id] = sequence;
+    if (walk_depth == 0 && needs_compaction()) compact();
+    return add_node(id, arena.append(sequence));
+}
+
+handle_t BidirectedGraph::add_node(const nid_t& id, const SequenceSpan& span) {
+    size_t slot = add_slot(id);
+    if (!present[slot]) {
+        present[slot] = true;
+        /// Stale bounds are rescanned when next queried, which finds this
+        /// node too
+        if (!stale_bounds) {
+            if (summary.node_count == 0 || id < summary.min_id) summary.min_id = id;
+            if (summary.node_count == 0 || id > summary.max_id) summary.max_id = id;
+        }
+        summary.node_count++;
+        /// Both sides start without edges
+        if (summary.degree_histogram.empty()) summary.degree_histogram.push_back(0);
+        summary.degree_histogram[0] += 2;
+    } else {
+        arena.release(spans[slot]);
+        summary.total_length -= spans[slot].length;
+    }
+    spans[slot] = span;
+    summary.total_length += span.length;
     cur_id = (id >= cur_id) ? id + 1 : cur_id; // Simple cur_id update function
     return get_handle(id);
 }
 
 void BidirectedGraph::create_edge(const handle_t& left, const handle_t& right) {
+    /// Both nodes must exist
+    AdjacencyList* from = get_adjacency(left);
+    AdjacencyList* to = get_adjacency(flip(right));
+    if (from == nullptr || to == nullptr) return;
+
     /// From left to right
-    edges.emplace(left, unordered_set<handle_t>());
-    edges[left].insert(right);
+    if (!from->insert(right)) return;
+    summary.edge_count++;
+    count_degree(from->size() - 1, from->size());
 
     // Don't create complement if it's an inversion
     if (left == flip(right)) return;
 
     /// Create complement from right to left
-    edges.emplace(flip(right), unordered_set<handle_t>());
-    edges[flip(right)].insert(flip(left));
+    to->insert(flip(left));
+    count_degree(to->size() - 1, to->size());
 }
 
 handle_t BidirectedGraph::apply_orientation(const handle_t& handle) {
@@ -195,24 +716,142 @@ handle_t BidirectedGraph::apply_orientation(const handle_t& handle) {
 }
 
 vector<handle_t> BidirectedGraph::divide_handle(const handle_t& handle, const vector<size_t>& offsets) {
-    /// TODO: Incorrect implementation
-    return vector<handle_t>();
+    nid_t id = get_id(handle);
+    size_t slot = get_slot(id);
+    if (slot == NO_SLOT) return vector<handle_t>();
+    bool is_reverse = get_is_reverse(handle);
+    SequenceSpan span = spans[slot];
+
+    /// Cut points on the forward strand
+    vector<size_t> cuts;
+    cuts.reserve(offsets.size() + 2);
+    cuts.push_back(0);
+    for (size_t i = 0; i < offsets.size(); i++) {
+        size_t offset = offsets[is_reverse ? offsets.size() - 1 - i : i];
+        if (offset == 0 || offset >= span.length) continue;
+        size_t cut = is_reverse ? span.length - offset : offset;
+        if (cut > cuts.back()) cuts.push_back(cut);
+    }
+    cuts.push_back(span.length);
+    if (cuts.size() == 2) return vector<handle_t>(1, handle);
+
+    /// Take the node's edges off before it's split. Each edge is collected
+    /// from every side of this node it touches, so self edges may repeat.
+    vector<pair<handle_t, handle_t>> edges;
+    for (bool side_is_reverse : {false, true}) {
+        handle_t side = get_handle(id, side_is_reverse);
+        for (const auto& rhandle : adjacency[2 * slot + side_is_reverse]) {
+            edges.emplace_back(side, rhandle);
+        }
+    }
+    for (const auto& [left, right] : edges) destroy_edge(left, right);
+
+    /// The pieces point into the node's stored sequence, so nothing is
+    /// copied. The first piece keeps the node and its ID.
+    vector<handle_t> pieces;
+    pieces.reserve(cuts.size() - 1);
+    pieces.push_back(get_handle(id));
+    spans[slot].length = cuts[1];
+    summary.total_length -= span.length - cuts[1];
+    for (size_t i = 1; i + 1 < cuts.size(); i++) {
+        SequenceSpan piece = {span.offset + cuts[i], cuts[i + 1] - cuts[i]};
+        nid_t piece_id = cur_id;
+        pieces.push_back(add_node(piece_id, piece));
+        create_edge(pieces[i - 1], pieces[i]);
+    }
+
+    /// Edges on the node's left side now attach to the first piece and those
+    /// on its right side to the last. An edge leaving the node forward leaves
+    /// the last piece; one leaving it in reverse leaves the first.
+    auto leaving = [&](const handle_t& side) {
+        if (get_id(side) != id) return side;
+        return get_is_reverse(side) ? flip(pieces.front()) : pieces.back();
+    };
+    for (const auto& [left, right] : edges) {
+        create_edge(leaving(left), flip(leaving(flip(right))));
+    }
+
+    if (is_reverse) {
+        reverse(pieces.begin(), pieces.end());
+        for (auto& piece : pieces) piece = flip(piece);
+    }
+    return pieces;
+}
+
+void BidirectedGraph::divide_handles(size_t max_length) {
+    if (max_length == 0) return;
+
+    /// Collect the long nodes first since splitting adds nodes
+    vector<nid_t> long_nodes;
+    for (size_t slot : get_slot_order()) {
+        if (spans[slot].length > max_length) long_nodes.push_back(get_slot_id(slot));
+    }
+
+    vector<size_t> offsets;
+    for (const auto& id : long_nodes) {
+        offsets.clear();
+        size_t length = spans[get_slot(id)].length;
+        for (size_t offset = max_length; offset < length; offset += max_length) {
+            offsets.push_back(offset);
+        }
+        divide_handle(get_handle(id), offsets);
+    }
 }
 
 void BidirectedGraph::optimize(bool allow_id_reassignment) {
-    /// TODO: Incorrect implementation
+    /// Keep the current order but drop empty slots and released sequence
+    /// space, numbering the nodes 1..N if allowed
+    vector<size_t> order = get_slot_order();
+    vector<nid_t> new_ids(present.size(), 0);
+    for (size_t i = 0; i < order.size(); i++) {
+        new_ids[order[i]] = allow_id_reassignment ? static_cast<nid_t>(i) + 1 : get_slot_id(order[i]);
+    }
+    if (allow_id_reassignment) cur_id = 1;
+    rebuild(order, new_ids);
 }
 
 void BidirectedGraph::apply_ordering(const vector<handle_t>& order, bool compact_ids) {
-    /// TODO: Incorrect implementation
+    /// Slots in the requested order. Nodes the order leaves out keep their
+    /// relative order after it.
+    vector<size_t> slot_order;
+    vector<bool> placed(present.size(), false);
+    slot_order.reserve(summary.node_count);
+    for (const auto& handle : order) {
+        size_t slot = get_slot(get_id(handle));
+        if (slot == NO_SLOT || placed[slot]) continue;
+        placed[slot] = true;
+        slot_order.push_back(slot);
+    }
+    for (size_t slot = 0; slot < present.size(); slot++) {
+        if (present[slot] && !placed[slot]) slot_order.push_back(slot);
+    }
+
+    vector<nid_t> new_ids(present.size(), 0);
+    for (size_t i = 0; i < slot_order.size(); i++) {
+        new_ids[slot_order[i]] = compact_ids ? static_cast<nid_t>(i) + 1 : get_slot_id(slot_order[i]);
+    }
+    if (compact_ids) cur_id = 1;
+    rebuild(slot_order, new_ids);
 }
 
 void BidirectedGraph::set_id_increment(const nid_t& min_id) {
-    /// TODO: Incorrect implementation
+    /// New nodes without an explicit ID are numbered from at least min_id
+    cur_id = max(cur_id, min_id);
 }
 
 void BidirectedGraph::reassign_node_ids(const function<nid_t(const nid_t&)>& get_new_id) {
-    /// TODO: Incorrect implementation
+    vector<size_t> order = get_slot_order();
+    vector<nid_t> new_ids(present.size(), 0);
+    for (size_t slot : order) {
+        nid_t id = get_new_id(get_slot_id(slot));
+        new_ids[slot] = (id == 0) ? get_slot_id(slot) : id;
+    }
+
+    /// Store the renamed nodes in ID order so they can stay dense
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return new_ids[a] < new_ids[b];
+    });
+    rebuild(order, new_ids);
 }
 
 //******************************************************************************
@@ -220,40 +859,90 @@ void BidirectedGraph::reassign_node_ids(const function<nid_t(const nid_t&)>& get
 //******************************************************************************
 
 void BidirectedGraph::destroy_handle(const handle_t& handle) {
-    /// Erase from nodes
-    nodes.erase(get_id(handle));
-
-    /// Remove edges in the "forward" direction
-    handle_t flipped = flip(handle);
-    /// Remove complement edges
-    for (auto& rhandle : edges[handle]) {
-        edges[flip(rhandle)].erase(flipped);
+    nid_t id = get_id(handle);
+    size_t slot = get_slot(id);
+    if (slot == NO_SLOT) return;
+
+    /// Remove complement edges from the neighbors of both node-sides. Edges
+    /// back to this node (self-cycles, inversions) go away with its own lists.
+    /// Self edges are listed from both of their sides except for inversions,
+    /// so inversions are counted twice and the total is halved.
+    size_t self_entries = 0;
+    for (bool is_reverse : {false, true}) {
+        handle_t side = get_handle(id, is_reverse);
+        for (const auto& rhandle : adjacency[2 * slot + is_reverse]) {
+            if (get_id(rhandle) == id) {
+                self_entries += (rhandle == flip(side)) ? 2 : 1;
+                continue;
+            }
+            AdjacencyList* neighbors = get_adjacency(flip(rhandle));
+            neighbors->erase(flip(side));
+            count_degree(neighbors->size() + 1, neighbors->size());
+            summary.edge_count--;
+        }
+        uncount_degree(adjacency[2 * slot + is_reverse].size());
+        adjacency[2 * slot + is_reverse].clear();
     }
-    /// Delete "forward edges" from handle
-    edges.erase(handle);
-
-    /// Remove edges in the "backward" direction
-    /// Remove complement edges
-    for (auto& rhandle : edges[flipped]) {
-        edges[flip(rhandle)].erase(handle);
+    summary.edge_count -= self_entries / 2;
+
+    /// Leave the slot behind as a tombstone. Its storage, and for hashed IDs
+    /// its table entry, is reclaimed in bulk by compact().
+    present[slot] = false;
+    arena.release(spans[slot]);
+    summary.total_length -= spans[slot].length;
+    spans[slot] = SequenceSpan();
+    summary.node_count--;
+
+    /// Tighten the ID bounds. Dense slots are in ID order so the next bound
+    /// is the nearest occupied slot; hashed IDs are rescanned when queried.
+    if (summary.node_count > 0 && (id == summary.min_id || id == summary.max_id)) {
+        if (is_dense) {
+            size_t lo = summary.min_id - id_base;
+            size_t hi = summary.max_id - id_base;
+            while (!present[lo]) lo++;
+            while (!present[hi]) hi--;
+            summary.min_id = get_slot_id(lo);
+            summary.max_id = get_slot_id(hi);
+        } else {
+            stale_bounds = true;
+        }
     }
-    /// Delete "forward edges" from handle
-    edges.erase(flipped);
 }
 
 void BidirectedGraph::destroy_edge(const handle_t& left, const handle_t& right) {
     /// Check if it's been destroyed already
-    if (!edges.count(left)) return;
+    AdjacencyList* from = get_adjacency(left);
+    AdjacencyList* to = get_adjacency(flip(right));
+    if (from == nullptr || to == nullptr) return;
 
     /// Erase forward edge
-    edges[left].erase(right);
-    /// Erase complement edge
-    edges[flip(right)].erase(flip(left));
+    if (!from->erase(right)) return;
+    summary.edge_count--;
+    count_degree(from->size() + 1, from->size());
+    /// Erase complement edge, which an inversion doesn't have
+    if (to->erase(flip(left))) count_degree(to->size() + 1, to->size());
 }
 
 void BidirectedGraph::clear() {
-    nodes.clear();
-    edges.clear();
+    is_dense = true;
+    id_base = 0;
+    sparse_slots.clear();
+    slot_ids.clear();
+    present.clear();
+    spans.clear();
+    arena = SequenceArena();
+    adjacency.clear();
+    summary = GraphStats();
+    stale_bounds = false;
+    compact_size = 0;
+    gfa_paths.clear();
+}
+
+void BidirectedGraph::compact() {
+    vector<size_t> order = get_slot_order();
+    vector<nid_t> ids(present.size(), 0);
+    for (size_t slot : order) ids[slot] = get_slot_id(slot);
+    rebuild(order, ids);
 }
 
 //******************************************************************************
@@ -262,15 +951,18 @@ void BidirectedGraph::clear() {
 
 bool BidirectedGraph::follow_edges_impl(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const {
     /// Get handle of proper direction
-    handle_t lhandle;
-    if (go_left) lhandle = flip(handle);
-    else lhandle = *const_cast<handle_t*>(&handle);
-
-    /// Early exit if there aren't any edges for that handle
-    if (!edges.count(lhandle)) return true;
-
-    /// Otherwise iterate through every edge
-    for (auto& rhandle : edges.at(lhandle)) {
+    handle_t lhandle = go_left ? flip(handle) : handle;
+
+    /// Early exit if the node doesn't exist
+    size_t slot = get_slot(get_id(lhandle));
+    if (slot == NO_SLOT) return true;
+
+    /// Otherwise iterate through every edge. The list is looked up again on
+    /// every step since the iteratee may add nodes or edges.
+    WalkGuard guard;
+    size_t side = 2 * slot + get_is_reverse(lhandle);
+    for (size_t i = 0; i < adjacency[side].size(); i++) {
+        handle_t rhandle = adjacency[side][i];
         if (!iteratee((go_left ? flip(rhandle) : rhandle))) return false;
     }
     return true;
@@ -278,8 +970,18 @@ bool BidirectedGraph::follow_edges_impl(const handle_t& handle, bool go_left, co
         
 
 bool BidirectedGraph::for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel) const {
-    for (auto& [nid, _] : nodes) {
-        if (!iteratee(get_handle(nid))) return false;
+    /// The graph may not be modified during a parallel iteration, so the
+    /// slot range can be split across the thread pool
+    if (parallel) {
+        return ThreadPool::get_instance().parallel_for(present.size(), [&](size_t slot) {
+            return !present[slot] || iteratee(get_handle(get_slot_id(slot)));
+        });
+    }
+
+    /// Slots may be appended by the iteratee, so recheck the size every step
+    WalkGuard guard;
+    for (size_t slot = 0; slot < present.size(); slot++) {
+        if (present[slot] && !iteratee(get_handle(get_slot_id(slot)))) return false;
     }
     return true;
 }
@@ -13,18 +13,173 @@
 /* Handlegraph includes */
 #include "algorithms/handle.hpp"
 
+#include "AdjacencyList.hpp"
+#include "MemoryUsage.hpp"
+#include "SequenceArena.hpp"
+
 using namespace std;
 using namespace handlegraph;
 
+/// Summary statistics of a BidirectedGraph, kept up to date by every edit.
+struct GraphStats {
+    size_t node_count = 0;
+    size_t edge_count = 0;
+    /// Total sequence length of all nodes
+    size_t total_length = 0;
+    /// Smallest and largest node IDs. Unspecified if the graph is empty.
+    nid_t min_id = 0;
+    nid_t max_id = 0;
+    /// degree_histogram[d] is the number of node-sides with exactly d edges.
+    /// The last entry is never zero, so the largest degree is size() - 1.
+    vector<size_t> degree_histogram;
+};
+
+/// How much of each node's sequence deserialize keeps. Bundles, SCCs,
+/// topological sorts and the decomposition only need the topology, and
+/// leaving the sequences out saves most of the memory and load time.
+enum class LoadMode {
+    /// Sequences are stored
+    FULL,
+    /// Only lengths are kept and every base reads as N
+    LENGTHS_ONLY,
+    /// Only IDs and edges are kept and every node has length 0
+    TOPOLOGY_ONLY
+};
+
+class BidirectedGraphOverlay;
+
 class BidirectedGraph : public DeletableHandleGraph {
+    friend class BidirectedGraphBuilder;
+    friend class BidirectedGraphOverlay;
+
     private:
-        unordered_map<nid_t, string> nodes;
-        unordered_map<handle_t, unordered_set<handle_t>> edges;
+        /// Node storage. Every node owns a slot in the per-slot vectors below.
+        /// While IDs are compact a node's slot is simply id - id_base. Once
+        /// IDs become too sparse for that, slots are looked up in sparse_slots.
+        bool is_dense = true;
+        nid_t id_base = 0;
+        /// Destroyed nodes keep their slot, and hashed IDs their entry, as a
+        /// tombstone until the next compaction.
+        unordered_map<nid_t, size_t> sparse_slots; // Only used if !is_dense
+        vector<nid_t> slot_ids;                    // Only used if !is_dense
+        vector<bool> present;                      // Is a node in the slot
+        vector<SequenceSpan> spans;                // Sequence location in arena
+
+        /// All node sequences, 2-bit packed
+        SequenceArena arena;
+
+        /// Neighbors reached by following edges from the right (go_left =
+        /// false) side of each handle. The list of the handle for slot s in
+        /// orientation r is adjacency[2 * s + r].
+        vector<AdjacencyList> adjacency;
         nid_t cur_id = 0;
 
+        /// Node and edge counts, ID bounds and degrees. The ID bounds of a
+        /// hashed graph are only recomputed when queried after the node
+        /// holding one of them was destroyed.
+        mutable GraphStats summary;
+        mutable bool stale_bounds = false;
+
+        /// P and W lines read from GFA, written back unchanged by serialize_gfa
+        vector<string> gfa_paths;
+
+        /// Number of slots right after the storage was last laid out
+        size_t compact_size = 0;
+
+        /// A dense range may have at most this many slots per node (plus
+        /// DENSE_SLACK) before the graph falls back to hashing IDs.
+        static const size_t DENSE_FACTOR = 4;
+        static const size_t DENSE_SLACK = 1024;
+        static const size_t NO_SLOT = static_cast<size_t>(-1);
+        /// Dead slots and released bases tolerated before compacting
+        static const size_t COMPACT_SLACK = 1024;
+        static const size_t COMPACT_BASES = 1 << 16;
+
+        /// Walks over any BidirectedGraph running on this thread. Compacting
+        /// renumbers the slots a walk is stepping through, so create_handle
+        /// only compacts when there are none.
+        static thread_local size_t walk_depth;
+        /// Counts a walk for as long as it's in scope
+        struct WalkGuard {
+            WalkGuard() { walk_depth++; }
+            ~WalkGuard() { walk_depth--; }
+        };
+
+        /// Returns the slot of the node or NO_SLOT if it doesn't exist.
+        size_t get_slot(const nid_t& node_id) const;
+        /// Returns the ID of the node that owns the slot.
+        nid_t get_slot_id(size_t slot) const;
+        /// Returns the adjacency list of the handle's node-side, or nullptr
+        /// if its node doesn't exist.
+        AdjacencyList* get_adjacency(const handle_t& handle);
+        const AdjacencyList* get_adjacency(const handle_t& handle) const;
+        /// Returns the slot for a new node with the given ID, growing or
+        /// converting the storage if needed.
+        size_t add_slot(const nid_t& node_id);
+        /// Returns true if a dense range of this many slots is compact enough
+        /// for the given number of nodes.
+        static bool is_compact(size_t range, size_t count);
+        /// Grows the dense range so it covers IDs [lo, hi].
+        void resize_dense(const nid_t& lo, const nid_t& hi);
+        /// Switches to hashed slot lookup. Slots keep their positions.
+        void make_sparse();
+        /// Sizes the node storage for IDs in [min_id, max_id] before a bulk load.
+        void reserve_ids(const nid_t& min_id, const nid_t& max_id, size_t count);
+        /// Lays the nodes out again with the slots in order (old slot numbers)
+        /// stored one after another, renaming each to new_ids[old slot].
+        /// Sequences are re-packed into a fresh arena. Storage is dense if the
+        /// new IDs ascend along the order and are compact, otherwise hashed.
+        void rebuild(const vector<size_t>& order, const vector<nid_t>& new_ids);
+        /// Returns the occupied slots in iteration order.
+        vector<size_t> get_slot_order() const;
+        /// Moves one node-side from one degree bucket to another.
+        void count_degree(size_t old_degree, size_t new_degree);
+        /// Removes a node-side of the given degree from the histogram.
+        void uncount_degree(size_t degree);
+        /// Recomputes the ID bounds if they are stale.
+        void update_bounds() const;
+        /// Adds a node whose sequence is already in the arena, or replaces the
+        /// sequence of an existing node.
+        handle_t add_node(const nid_t& id, const SequenceSpan& span);
+        /// Returns true once destroyed nodes and released sequences take up
+        /// more room than the live ones.
+        bool needs_compaction() const;
+        /// Writes the nodes in the given slot order, and their edges, as vg JSON.
+        bool write_json(ofstream& outfile, const vector<size_t>& order) const;
+
     public:
-        bool deserialize(ifstream& infile);        
-        bool serialize(ofstream& outfile);
+        /// Reads vg JSON. Modes other than FULL take effect when loading
+        /// into an empty graph, and last until the graph is cleared.
+        bool deserialize(ifstream& infile, LoadMode mode = LoadMode::FULL);
+
+        /// Returns false if the graph was loaded without its sequences.
+        bool has_sequences() const;
+
+        /// Writes vg JSON straight to the stream, each edge once. Nodes are
+        /// written in storage order, or by ID if sort_by_id is true, and
+        /// edges follow the node they start from.
+        bool serialize(ofstream& outfile, bool sort_by_id = false);
+        /// Writes vg JSON with the nodes in the given order. Orientations in
+        /// the order are ignored, and nodes it leaves out follow in storage order.
+        bool serialize(ofstream& outfile, const vector<handle_t>& order);
+
+        /// Reads GFA v1 line by line. S lines become nodes with "*" for an
+        /// empty sequence. Segment names must be integers and are used as the
+        /// node IDs; named segments are rejected rather than numbered, since
+        /// nothing could map the IDs back to their names. L lines become
+        /// edges and must be blunt ("0M" or "*"), as nodes can't share bases.
+        /// P and W lines are kept as they are for serialize_gfa. Other lines
+        /// are skipped. With LENGTHS_ONLY a "*" segment takes its length from
+        /// an LN tag.
+        /// Returns false and adds nothing if a line can't be parsed.
+        bool deserialize_gfa(ifstream& infile, LoadMode mode = LoadMode::FULL);
+        /// Writes GFA v1: a header, an S line per node, an L line per edge
+        /// and then the P and W lines that were read. Without sequences,
+        /// segments are written as "*" with an LN tag.
+        bool serialize_gfa(ofstream& outfile);
+        /// Writes the binary graph format, which MappedBidirectedGraph serves
+        /// without parsing.
+        bool serialize_binary(ofstream& outfile);
 
         /// Method to check if a node exists by ID
         bool has_node(nid_t node_id) const;
@@ -47,6 +202,28 @@ class BidirectedGraph : public DeletableHandleGraph {
         /// Get the sequence of a node, presented in the handle's local forward
         /// orientation.
         string get_sequence(const handle_t& handle) const;
+
+        /// Decode the sequence of a node into the given buffer, presented in
+        /// the handle's local forward orientation.
+        void get_sequence(const handle_t& handle, string& buffer) const;
+
+        /// Get a single base of a node in the handle's local forward orientation.
+        char get_base(const handle_t& handle, size_t index) const;
+
+        /// Get a substring of a node's sequence in the handle's local forward
+        /// orientation. Only the requested bases are decoded; the substring is
+        /// clipped to the end of the node.
+        string get_subsequence(const handle_t& handle, size_t index, size_t size) const;
+
+        /// Get a view of a node's sequence in the handle's local forward
+        /// orientation without decoding or copying it. The view is valid until
+        /// the graph is next modified.
+        SequenceView get_sequence_view(const handle_t& handle) const;
+
+        /// Loop over the sequences of all nodes in their local forward
+        /// orientations, in storage order. Stop if the iteratee returns false.
+        /// Returns true if we finished and false if we stopped early.
+        bool for_each_sequence(const function<bool(const handle_t&, const SequenceView&)>& iteratee) const;
         
         /// Return the number of nodes in the graph
         size_t get_node_count() const;
@@ -59,6 +236,34 @@ class BidirectedGraph : public DeletableHandleGraph {
         /// largest ID is unavailable. Return value is unspecified if the graph is empty.
         nid_t max_node_id() const;
 
+        /// Get the number of edges on the right (go_left = false) or left (go_left
+        /// = true) side of the given handle.
+        size_t get_degree(const handle_t& handle, bool go_left) const;
+
+        /// Returns true if there is an edge that allows traversal from the left
+        /// handle to the right handle.
+        bool has_edge(const handle_t& left, const handle_t& right) const;
+        using DeletableHandleGraph::has_edge;
+
+        /// Return the total number of edges in the graph.
+        size_t get_edge_count() const;
+
+        /// Return the total length of all nodes' sequences.
+        size_t get_total_length() const;
+
+        /// Return the node and edge counts, ID bounds and degree histogram.
+        /// Cheap enough to poll: everything is maintained by the edits.
+        const GraphStats& stats() const;
+
+        /// Return a mutable copy-on-write view of this graph. Changes made to
+        /// the view are kept in the view, so this graph stays unchanged and can
+        /// still be read from other threads. This graph must not be modified
+        /// or destroyed while the view is in use.
+        BidirectedGraphOverlay snapshot() const;
+
+        /// Return an estimate of the memory held by each part of the graph.
+        MemoryUsage memory_usage() const;
+
         /// Create a new node with the given sequence and return the handle.
         handle_t create_handle(const string& sequence);
 
@@ -85,8 +290,17 @@ class BidirectedGraph : public DeletableHandleGraph {
         /// same local forward orientation as the original node, but the returned
         /// handles come in the order and orientation appropriate for the handle
         /// passed in.
+        /// The first piece in the node's forward orientation keeps the node's
+        /// ID. Offsets that are out of range or not increasing are skipped.
+        /// Takes time proportional to the node's degree plus the number of
+        /// pieces; the pieces share the node's stored sequence.
         /// Updates stored paths.
         vector<handle_t> divide_handle(const handle_t& handle, const vector<size_t>& offsets);
+        using MutableHandleGraph::divide_handle;
+
+        /// Split every node longer than max_length into pieces of max_length
+        /// bases (the last piece may be shorter), in one pass over the graph.
+        void divide_handles(size_t max_length);
         
         /// Adjust the representation of the graph in memory to improve performance.
         /// Optionally, allow the node IDs to be reassigned to further improve
@@ -114,6 +328,8 @@ class BidirectedGraph : public DeletableHandleGraph {
         void reassign_node_ids(const function<nid_t(const nid_t&)>& get_new_id);
 
         /// Remove the node belonging to the given handle and all of its edges.
+        /// Takes time proportional to the node's degree; its storage is freed
+        /// later by compact().
         /// Does not update any stored paths.
         /// Invalidates the destroyed handle.
         /// May be called during serial for_each_handle iteration **ONLY** on the node being iterated.
@@ -129,6 +345,14 @@ class BidirectedGraph : public DeletableHandleGraph {
         /// Remove all nodes and edges.
         void clear();
 
+        /// Free the slots of destroyed nodes and the space of released
+        /// sequences, keeping the iteration order and IDs. Runs on its own from
+        /// create_handle once the garbage outweighs the live nodes, unless
+        /// for_each_handle, follow_edges or for_each_sequence is running on the
+        /// same thread, so it only needs calling to reclaim memory early.
+        /// Must not be called during any of those.
+        void compact();
+
     protected:
         
         /// Loop over all the handles to next/previous (right/left) nodes. Passes
@@ -142,6 +366,9 @@ class BidirectedGraph : public DeletableHandleGraph {
         /// after a false return value is on a best-effort basis and iteration
         /// order is not defined. Returns true if we finished and false if we 
         /// stopped early.
+        /// Parallel iteration runs on the shared ThreadPool, whose size is set
+        /// with ThreadPool::set_thread_count. The iteratee must be thread-safe
+        /// and may not modify the graph.
         bool for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel = false) const;
 };
 #endif /* BidirectedGraph_hpp */
@@ -0,0 +1,201 @@
+#include "BidirectedGraphBuilder.hpp"
+
+#include <algorithm>
+#include <limits>
+using namespace std;
+
+//******************************************************************************
+// Public functions
+//******************************************************************************
+
+void BidirectedGraphBuilder::reserve(size_t node_count, size_t edge_count, size_t total_length) {
+    nodes.reserve(nodes.size() + node_count);
+    entries.reserve(entries.size() + 2 * edge_count);
+    arena.reserve(total_length);
+}
+
+void BidirectedGraphBuilder::add_node(const nid_t& id, const string& sequence) {
+    nodes.emplace_back(id, arena.append(sequence));
+}
+
+void BidirectedGraphBuilder::add_node_length(const nid_t& id, size_t length) {
+    SequenceSpan span;
+    span.length = length;
+    if (arena.has_bases()) span = arena.append(string(length, 'N'));
+    nodes.emplace_back(id, span);
+}
+
+void BidirectedGraphBuilder::add_edge(const handle_t& left, const handle_t& right) {
+    entries.emplace_back(left, right);
+
+    /// Inversions are their own complement
+    if (left != g.flip(right)) entries.emplace_back(g.flip(right), g.flip(left));
+}
+
+void BidirectedGraphBuilder::absorb(BidirectedGraphBuilder& other) {
+    if (nodes.empty() && entries.empty()) {
+        swap(nodes, other.nodes);
+        swap(entries, other.entries);
+        swap(arena, other.arena);
+    } else {
+        /// Spans are relative to the arena they were packed into, so the
+        /// sequences are repacked onto the end of ours
+        for (const auto& [id, span] : other.nodes) {
+            nodes.emplace_back(id, arena.append(other.arena, span));
+        }
+        entries.insert(entries.end(), other.entries.begin(), other.entries.end());
+    }
+
+    other.nodes.clear();
+    other.entries.clear();
+    other.arena.clear();
+}
+
+void BidirectedGraphBuilder::finalize() {
+    if (g.get_node_count() == 0) {
+        build();
+    } else {
+        merge();
+    }
+
+    nodes.clear();
+    entries.clear();
+    arena.clear();
+}
+
+//******************************************************************************
+// Private functions
+//******************************************************************************
+
+void BidirectedGraphBuilder::build() {
+    g.clear();
+    if (nodes.empty()) return;
+
+    /// Sort nodes by ID. The last node added with an ID replaces the others.
+    auto by_id = [](const pair<nid_t, SequenceSpan>& a, const pair<nid_t, SequenceSpan>& b) {
+        return a.first < b.first;
+    };
+    if (!is_sorted(nodes.begin(), nodes.end(), by_id)) {
+        stable_sort(nodes.begin(), nodes.end(), by_id);
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (count > 0 && nodes[count - 1].first == nodes[i].first) {
+            arena.release(nodes[count - 1].second);
+            nodes[count - 1] = nodes[i];
+        } else {
+            nodes[count++] = nodes[i];
+        }
+    }
+    nodes.resize(count);
+
+    /// Lay out the node storage the same way add_slot would have
+    nid_t lo = nodes.front().first;
+    nid_t hi = nodes.back().first;
+    bool dense = BidirectedGraph::is_compact(static_cast<size_t>(hi - lo) + 1, count);
+    size_t size = dense ? static_cast<size_t>(hi - lo) + 1 : count;
+
+    g.is_dense = dense;
+    g.id_base = dense ? lo : 0;
+    g.present.assign(size, false);
+    g.spans.assign(size, SequenceSpan());
+    g.adjacency = vector<AdjacencyList>(2 * size);
+    g.compact_size = size;
+    if (!dense) {
+        g.slot_ids.resize(size);
+        g.sparse_slots.reserve(count);
+    }
+
+    GraphStats& summary = g.summary;
+    for (size_t i = 0; i < count; i++) {
+        const auto& [id, span] = nodes[i];
+        size_t slot = dense ? static_cast<size_t>(id - lo) : i;
+        if (!dense) {
+            g.slot_ids[slot] = id;
+            g.sparse_slots[id] = slot;
+        }
+        g.present[slot] = true;
+        g.spans[slot] = span;
+        summary.total_length += span.length;
+    }
+    g.arena = move(arena);
+    arena = SequenceArena(g.arena.has_bases());
+
+    /// Bucket the edge targets by node-side (a counting sort on the side
+    /// index), then sort and dedupe each node-side's short run. Edges to or
+    /// from nodes that weren't added are dropped.
+    auto get_side = [&](const handle_t& handle) {
+        size_t slot = g.get_slot(g.get_id(handle));
+        return slot == BidirectedGraph::NO_SLOT ? slot : 2 * slot + g.get_is_reverse(handle);
+    };
+    vector<size_t> offsets(2 * size + 1, 0);
+    for (const auto& [from, to] : entries) {
+        size_t side = get_side(from);
+        if (side == BidirectedGraph::NO_SLOT || get_side(to) == BidirectedGraph::NO_SLOT) continue;
+        offsets[side + 1]++;
+    }
+    for (size_t i = 1; i < offsets.size(); i++) offsets[i] += offsets[i - 1];
+
+    vector<handle_t> targets(offsets.back());
+    vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    for (const auto& [from, to] : entries) {
+        size_t side = get_side(from);
+        if (side == BidirectedGraph::NO_SLOT || get_side(to) == BidirectedGraph::NO_SLOT) continue;
+        targets[next[side]++] = to;
+    }
+    vector<pair<handle_t, handle_t>>().swap(entries);
+
+    auto less = [](const handle_t& a, const handle_t& b) { return as_integer(a) < as_integer(b); };
+    summary.degree_histogram.assign(1, 2 * count);
+    size_t stored = 0;
+    size_t inversions = 0;
+    for (size_t side = 0; side < 2 * size; side++) {
+        auto first = targets.begin() + offsets[side];
+        auto last = targets.begin() + offsets[side + 1];
+        if (first == last) continue;
+        sort(first, last, less);
+        last = unique(first, last);
+        size_t degree = last - first;
+        g.adjacency[side].assign(&*first, &*first + degree);
+
+        stored += degree;
+        handle_t from = g.get_handle(g.get_slot_id(side / 2), side % 2);
+        inversions += binary_search(first, last, g.flip(from), less);
+        if (degree >= summary.degree_histogram.size()) {
+            summary.degree_histogram.resize(degree + 1, 0);
+        }
+        summary.degree_histogram[0]--;
+        summary.degree_histogram[degree]++;
+    }
+    while (summary.degree_histogram.back() == 0) summary.degree_histogram.pop_back();
+
+    summary.node_count = count;
+    summary.edge_count = (stored + inversions) / 2;
+    summary.min_id = lo;
+    summary.max_id = hi;
+    g.cur_id = max(g.cur_id, hi + 1);
+}
+
+void BidirectedGraphBuilder::merge() {
+    if (!nodes.empty()) {
+        nid_t min_id = numeric_limits<nid_t>::max();
+        nid_t max_id = numeric_limits<nid_t>::min();
+        for (const auto& node : nodes) {
+            min_id = min(min_id, node.first);
+            max_id = max(max_id, node.first);
+        }
+        g.reserve_ids(min_id, max_id, nodes.size());
+    }
+
+    string sequence;
+    for (const auto& [id, span] : nodes) {
+        arena.view(span, false).decode(sequence);
+        g.create_handle(sequence, id);
+    }
+
+    /// Complement entries describe the same edge again, which create_edge
+    /// ignores
+    for (const auto& [left, right] : entries) {
+        g.create_edge(left, right);
+    }
+}
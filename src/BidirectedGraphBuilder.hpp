@@ -0,0 +1,74 @@
+#ifndef BidirectedGraphBuilder_hpp
+#define BidirectedGraphBuilder_hpp
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BidirectedGraph.hpp"
+#include "SequenceArena.hpp"
+
+using namespace std;
+using namespace handlegraph;
+
+/// Loads many nodes and edges into a BidirectedGraph at once.
+/// Nodes and edges are appended to flat buffers, sequences are packed as
+/// they arrive, and finalize() sorts and dedupes the edges and lays out the
+/// whole graph in one pass instead of inserting edge by edge.
+///
+///     BidirectedGraphBuilder builder(g);
+///     builder.reserve(node_count, edge_count);
+///     builder.add_node(1, "GATT");
+///     builder.add_node(2, "ACA");
+///     builder.add_edge(g.get_handle(1), g.get_handle(2));
+///     builder.finalize();
+class BidirectedGraphBuilder {
+    private:
+        BidirectedGraph& g;
+
+        /// (ID, sequence location in arena) in the order added
+        vector<pair<nid_t, SequenceSpan>> nodes;
+        SequenceArena arena;
+
+        /// Each edge as it is stored: from the left handle and, unless it's
+        /// an inversion, from the flipped right handle
+        vector<pair<handle_t, handle_t>> entries;
+
+        /// Builds the graph's storage directly. The graph must be empty.
+        void build();
+
+        /// Adds everything through the regular graph API.
+        void merge();
+
+    public:
+        /// Builder that adds to the given graph when finalized. If keep_bases
+        /// is false only sequence lengths are recorded, and a graph built
+        /// from empty reads every base as N.
+        BidirectedGraphBuilder(BidirectedGraph& g_, bool keep_bases = true) : g(g_), arena(keep_bases) {}
+
+        /// Reserves room for the given number of nodes, edges and bases.
+        void reserve(size_t node_count, size_t edge_count, size_t total_length = 0);
+
+        /// Adds a node. If the same ID is added more than once the last
+        /// sequence wins, as with create_handle.
+        void add_node(const nid_t& id, const string& sequence);
+
+        /// Adds a node of the given length without a sequence. Its bases
+        /// read as N.
+        void add_node_length(const nid_t& id, size_t length);
+
+        /// Adds an edge between the given handles. Duplicate edges are
+        /// collapsed and edges to nodes that don't exist are dropped.
+        void add_edge(const handle_t& left, const handle_t& right);
+
+        /// Moves everything added to other into this builder, as if it had
+        /// been added here after everything else. Leaves other empty.
+        void absorb(BidirectedGraphBuilder& other);
+
+        /// Adds everything to the graph and empties the builder. Into an empty
+        /// graph this builds the storage in one pass; otherwise the nodes and
+        /// edges are added one by one.
+        void finalize();
+};
+
+#endif /* BidirectedGraphBuilder_hpp */
@@ -0,0 +1,284 @@
+#include "BidirectedGraphOverlay.hpp"
+
+#include "handlegraph/util.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+//******************************************************************************
+// Construction
+//******************************************************************************
+
+BidirectedGraphOverlay::BidirectedGraphOverlay(const BidirectedGraph& base_) : base(&base_) {
+    node_count = base->get_node_count();
+    edge_count = base->get_edge_count();
+    min_id = base->min_node_id();
+    max_id = base->max_node_id();
+    cur_id = max_id + 1;
+}
+
+//******************************************************************************
+// Private helpers
+//******************************************************************************
+
+bool BidirectedGraphOverlay::is_base(const nid_t& node_id) const {
+    return base->has_node(node_id) && (hidden.empty() || !hidden.count(node_id));
+}
+
+const AdjacencyList* BidirectedGraphOverlay::find_side(const handle_t& handle) const {
+    auto it = sides.find(handle);
+    if (it != sides.end()) return &it->second;
+    if (!is_base(get_id(handle))) return nullptr;
+    return base->get_adjacency(handle);
+}
+
+AdjacencyList* BidirectedGraphOverlay::get_side(const handle_t& handle) {
+    auto it = sides.find(handle);
+    if (it != sides.end()) return &it->second;
+
+    /// Overlay nodes always have their lists, so this must be the first
+    /// change to a base node-side
+    if (!is_base(get_id(handle))) return nullptr;
+    return &sides.emplace(handle, *base->get_adjacency(handle)).first->second;
+}
+
+//******************************************************************************
+// Handle graph public functions
+//******************************************************************************
+
+/// Method to check if a node exists by ID
+bool BidirectedGraphOverlay::has_node(nid_t node_id) const {
+    return owned.count(node_id) || is_base(node_id);
+}
+
+/// Look up the handle for the node with the given ID in the given orientation
+handle_t BidirectedGraphOverlay::get_handle(const nid_t& node_id, bool is_reverse) const {
+    return number_bool_packing::pack(node_id, is_reverse);
+}
+
+/// Get the ID from a handle
+nid_t BidirectedGraphOverlay::get_id(const handle_t& handle) const {
+    return number_bool_packing::unpack_number(handle);
+}
+
+/// Get the orientation of a handle
+bool BidirectedGraphOverlay::get_is_reverse(const handle_t& handle) const {
+    return number_bool_packing::unpack_bit(handle);
+}
+
+/// Invert the orientation of a handle (potentially without getting its ID)
+handle_t BidirectedGraphOverlay::flip(const handle_t& handle) const {
+    return number_bool_packing::toggle_bit(handle);
+}
+
+/// Get the length of a node
+size_t BidirectedGraphOverlay::get_length(const handle_t& handle) const {
+    auto it = owned.find(get_id(handle));
+    if (it != owned.end()) return it->second.length;
+    if (!is_base(get_id(handle))) throw out_of_range("BidirectedGraphOverlay: no such node");
+    return base->get_length(handle);
+}
+
+/// Get the sequence of a node, presented in the handle's local forward
+/// orientation.
+string BidirectedGraphOverlay::get_sequence(const handle_t& handle) const {
+    auto it = owned.find(get_id(handle));
+    if (it != owned.end()) return arena.view(it->second, get_is_reverse(handle)).str();
+    if (!is_base(get_id(handle))) throw out_of_range("BidirectedGraphOverlay: no such node");
+    return base->get_sequence(handle);
+}
+
+/// Return the number of nodes in the graph
+size_t BidirectedGraphOverlay::get_node_count() const {
+    return node_count;
+}
+
+/// Return the smallest ID in the graph, or some smaller number if the
+/// smallest ID is unavailable. Return value is unspecified if the graph is empty.
+nid_t BidirectedGraphOverlay::min_node_id() const {
+    return min_id;
+}
+
+/// Return the largest ID in the graph, or some larger number if the
+/// largest ID is unavailable. Return value is unspecified if the graph is empty.
+nid_t BidirectedGraphOverlay::max_node_id() const {
+    return max_id;
+}
+
+size_t BidirectedGraphOverlay::get_degree(const handle_t& handle, bool go_left) const {
+    const AdjacencyList* neighbors = find_side(go_left ? flip(handle) : handle);
+    return neighbors == nullptr ? 0 : neighbors->size();
+}
+
+bool BidirectedGraphOverlay::has_edge(const handle_t& left, const handle_t& right) const {
+    const AdjacencyList* neighbors = find_side(left);
+    return neighbors != nullptr && neighbors->contains(right);
+}
+
+size_t BidirectedGraphOverlay::get_edge_count() const {
+    return edge_count;
+}
+
+//******************************************************************************
+// Mutable handle graph public functions
+//******************************************************************************
+
+handle_t BidirectedGraphOverlay::create_handle(const string& sequence) {
+    return create_handle(sequence, cur_id);
+}
+
+handle_t BidirectedGraphOverlay::create_handle(const string& sequence, const nid_t& id) {
+    handle_t handle = get_handle(id);
+    auto it = owned.find(id);
+    if (it != owned.end()) {
+        /// Replace the sequence of an overlay node
+        arena.release(it->second);
+        it->second = arena.append(sequence);
+    } else {
+        if (is_base(id)) {
+            /// Replace a base node, keeping its edges
+            get_side(handle);
+            get_side(flip(handle));
+            hidden.insert(id);
+        } else {
+            sides[handle];
+            sides[flip(handle)];
+            min_id = node_count ? min(min_id, id) : id;
+            max_id = node_count ? max(max_id, id) : id;
+            node_count++;
+        }
+        owned[id] = arena.append(sequence);
+    }
+    cur_id = max(cur_id, id + 1);
+    return handle;
+}
+
+void BidirectedGraphOverlay::create_edge(const handle_t& left, const handle_t& right) {
+    /// Both nodes must exist, and existing edges are left alone so their
+    /// lists aren't copied for nothing
+    if (!has_node(get_id(left)) || !has_node(get_id(right)) || has_edge(left, right)) return;
+
+    get_side(left)->insert(right);
+    edge_count++;
+
+    // Don't create complement if it's an inversion
+    if (left == flip(right)) return;
+    get_side(flip(right))->insert(flip(left));
+}
+
+handle_t BidirectedGraphOverlay::apply_orientation(const handle_t&) {
+    throw logic_error("BidirectedGraphOverlay: apply_orientation is not supported");
+}
+
+vector<handle_t> BidirectedGraphOverlay::divide_handle(const handle_t&, const vector<size_t>&) {
+    throw logic_error("BidirectedGraphOverlay: divide_handle is not supported");
+}
+
+void BidirectedGraphOverlay::optimize(bool) {
+}
+
+void BidirectedGraphOverlay::apply_ordering(const vector<handle_t>&, bool) {
+    throw logic_error("BidirectedGraphOverlay: apply_ordering is not supported");
+}
+
+void BidirectedGraphOverlay::set_id_increment(const nid_t& min_next_id) {
+    cur_id = max(cur_id, min_next_id);
+}
+
+void BidirectedGraphOverlay::reassign_node_ids(const function<nid_t(const nid_t&)>&) {
+    throw logic_error("BidirectedGraphOverlay: reassign_node_ids is not supported");
+}
+
+//******************************************************************************
+// Deletable handle graph public functions
+//******************************************************************************
+
+void BidirectedGraphOverlay::destroy_handle(const handle_t& handle) {
+    nid_t id = get_id(handle);
+    if (!has_node(id)) return;
+
+    /// Remove complement edges from the neighbors of both node-sides, copying
+    /// their lists if they are still shared with the base. Self edges are
+    /// listed from both of their sides except for inversions, so inversions
+    /// are counted twice and the total is halved.
+    size_t self_entries = 0;
+    for (bool is_reverse : {false, true}) {
+        handle_t side = get_handle(id, is_reverse);
+        const AdjacencyList* neighbors = find_side(side);
+        for (size_t i = 0; i < neighbors->size(); i++) {
+            handle_t rhandle = (*neighbors)[i];
+            if (get_id(rhandle) == id) {
+                self_entries += (rhandle == flip(side)) ? 2 : 1;
+                continue;
+            }
+            get_side(flip(rhandle))->erase(flip(side));
+            edge_count--;
+        }
+    }
+    edge_count -= self_entries / 2;
+
+    /// Drop the node's own lists and hide or erase the node
+    sides.erase(handle);
+    sides.erase(flip(handle));
+    auto it = owned.find(id);
+    if (it != owned.end()) {
+        arena.release(it->second);
+        owned.erase(it);
+    }
+    if (base->has_node(id)) hidden.insert(id);
+    node_count--;
+}
+
+void BidirectedGraphOverlay::destroy_edge(const handle_t& left, const handle_t& right) {
+    if (!has_edge(left, right)) return;
+
+    get_side(left)->erase(right);
+    edge_count--;
+    if (left != flip(right)) get_side(flip(right))->erase(flip(left));
+}
+
+void BidirectedGraphOverlay::clear() {
+    base->for_each_handle([&](const handle_t& handle) {
+        hidden.insert(base->get_id(handle));
+    });
+    owned.clear();
+    arena.clear();
+    sides.clear();
+    node_count = 0;
+    edge_count = 0;
+}
+
+//******************************************************************************
+// Handle graph protected functions
+//******************************************************************************
+
+bool BidirectedGraphOverlay::follow_edges_impl(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const {
+    /// Get handle of proper direction
+    handle_t lhandle = go_left ? flip(handle) : handle;
+
+    /// Lists in the overlay stay put when others are added, and base lists
+    /// never change, so the list can be held while the iteratee runs
+    const AdjacencyList* neighbors = find_side(lhandle);
+    if (neighbors == nullptr) return true;
+    for (size_t i = 0; i < neighbors->size(); i++) {
+        handle_t rhandle = (*neighbors)[i];
+        if (!iteratee(go_left ? flip(rhandle) : rhandle)) return false;
+    }
+    return true;
+}
+
+bool BidirectedGraphOverlay::for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel) const {
+    bool finished = base->for_each_handle([&](const handle_t& handle) {
+        return !is_base(base->get_id(handle)) || iteratee(handle);
+    }, parallel);
+    if (!finished) return false;
+
+    /// The iteratee may destroy the node it is given, so step past it first
+    for (auto it = owned.begin(); it != owned.end();) {
+        nid_t id = it->first;
+        ++it;
+        if (!iteratee(get_handle(id))) return false;
+    }
+    return true;
+}
@@ -0,0 +1,163 @@
+#ifndef BidirectedGraphOverlay_hpp
+#define BidirectedGraphOverlay_hpp
+
+/* Data structures for internal representation */
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/* Handlegraph includes */
+#include "algorithms/handle.hpp"
+
+#include "AdjacencyList.hpp"
+#include "BidirectedGraph.hpp"
+#include "SequenceArena.hpp"
+
+using namespace std;
+using namespace handlegraph;
+
+/// Mutable copy-on-write view of a BidirectedGraph.
+/// The overlay starts out identical to its base graph and records every
+/// change as a delta: base nodes that were destroyed are hidden, new nodes
+/// live in the overlay, and a base node-side's edge list is copied into the
+/// overlay the first time it changes. The base is never written to, so it
+/// stays intact and other threads may keep reading it. The base must not be
+/// modified or destroyed while the overlay is in use.
+class BidirectedGraphOverlay : public DeletableHandleGraph {
+    private:
+        const BidirectedGraph* base;
+
+        /// Base nodes that were destroyed or replaced by an overlay node
+        unordered_set<nid_t> hidden;
+        /// Nodes created in the overlay, with their sequences in arena
+        map<nid_t, SequenceSpan> owned;
+        SequenceArena arena;
+        /// Edge lists of overlay nodes and of changed base node-sides
+        unordered_map<handle_t, AdjacencyList> sides;
+
+        size_t node_count = 0;
+        size_t edge_count = 0;
+        nid_t min_id = 0;
+        nid_t max_id = 0;
+        nid_t cur_id = 0;
+
+        /// Returns true if the node is a visible base node.
+        bool is_base(const nid_t& node_id) const;
+        /// Returns the edge list of the node-side for reading, or nullptr if
+        /// its node doesn't exist.
+        const AdjacencyList* find_side(const handle_t& handle) const;
+        /// Returns the edge list of the node-side for writing, copying a base
+        /// list into the overlay first. Returns nullptr if the node doesn't exist.
+        AdjacencyList* get_side(const handle_t& handle);
+
+    public:
+        /// Overlay over the given graph. Prefer BidirectedGraph::snapshot().
+        BidirectedGraphOverlay(const BidirectedGraph& base_);
+
+        /// Method to check if a node exists by ID
+        bool has_node(nid_t node_id) const;
+
+        /// Look up the handle for the node with the given ID in the given orientation
+        handle_t get_handle(const nid_t& node_id, bool is_reverse = false) const;
+
+        /// Get the ID from a handle
+        nid_t get_id(const handle_t& handle) const;
+
+        /// Get the orientation of a handle
+        bool get_is_reverse(const handle_t& handle) const;
+
+        /// Invert the orientation of a handle (potentially without getting its ID)
+        handle_t flip(const handle_t& handle) const;
+
+        /// Get the length of a node
+        size_t get_length(const handle_t& handle) const;
+
+        /// Get the sequence of a node, presented in the handle's local forward
+        /// orientation.
+        string get_sequence(const handle_t& handle) const;
+
+        /// Return the number of nodes in the graph
+        size_t get_node_count() const;
+
+        /// Return the smallest ID in the graph, or some smaller number if the
+        /// smallest ID is unavailable. Return value is unspecified if the graph is empty.
+        nid_t min_node_id() const;
+
+        /// Return the largest ID in the graph, or some larger number if the
+        /// largest ID is unavailable. Return value is unspecified if the graph is empty.
+        nid_t max_node_id() const;
+
+        /// Get the number of edges on the right (go_left = false) or left (go_left
+        /// = true) side of the given handle.
+        size_t get_degree(const handle_t& handle, bool go_left) const;
+
+        /// Returns true if there is an edge that allows traversal from the left
+        /// handle to the right handle.
+        bool has_edge(const handle_t& left, const handle_t& right) const;
+        using DeletableHandleGraph::has_edge;
+
+        /// Return the total number of edges in the graph.
+        size_t get_edge_count() const;
+
+        /// Create a new node with the given sequence and return the handle.
+        handle_t create_handle(const string& sequence);
+
+        /// Create a new node with the given id and sequence, then return the handle.
+        handle_t create_handle(const string& sequence, const nid_t& id);
+
+        /// Create an edge connecting the given handles in the given order and orientations.
+        /// Ignores existing edges.
+        void create_edge(const handle_t& left, const handle_t& right);
+
+        /// Not supported on an overlay; throws logic_error.
+        handle_t apply_orientation(const handle_t& handle);
+
+        /// Not supported on an overlay; throws logic_error.
+        vector<handle_t> divide_handle(const handle_t& handle, const vector<size_t>& offsets);
+
+        /// No-op: the overlay's layout follows its base.
+        void optimize(bool allow_id_reassignment = true);
+
+        /// Not supported on an overlay since its layout follows its base;
+        /// throws logic_error.
+        void apply_ordering(const vector<handle_t>& order, bool compact_ids = false);
+
+        /// Set a minimum id to increment the id space by, used as a hint during construction.
+        void set_id_increment(const nid_t& min_next_id);
+
+        /// Not supported on an overlay since base IDs can't change; throws
+        /// logic_error.
+        void reassign_node_ids(const function<nid_t(const nid_t&)>& get_new_id);
+
+        /// Remove the node belonging to the given handle and all of its edges.
+        /// Base nodes are hidden rather than removed.
+        /// May be called during serial for_each_handle iteration **ONLY** on the node being iterated.
+        /// May **NOT** be called during parallel for_each_handle iteration.
+        /// May **NOT** be called on the node from which edges are being followed during follow_edges.
+        void destroy_handle(const handle_t& handle);
+
+        /// Remove the edge connecting the given handles in the given order and orientations.
+        /// Ignores nonexistent edges.
+        void destroy_edge(const handle_t& left, const handle_t& right);
+
+        /// Remove all nodes and edges. The base is left as it is.
+        void clear();
+
+    protected:
+
+        /// Loop over all the handles to next/previous (right/left) nodes. Passes
+        /// them to a callback which returns false to stop iterating and true to
+        /// continue. Returns true if we finished and false if we stopped early.
+        bool follow_edges_impl(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const;
+
+        /// Loop over all the nodes in the graph in their local forward
+        /// orientations: visible base nodes in the base's order, then overlay
+        /// nodes by ID. Stop if the iteratee returns false. Can be told to run
+        /// in parallel, in which case only the base nodes are split across
+        /// threads and stopping after a false return value is on a best-effort
+        /// basis. Returns true if we finished and false if we stopped early.
+        bool for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel = false) const;
+};
+#endif /* BidirectedGraphOverlay_hpp */
@@ -0,0 +1,55 @@
+#include "ConcurrentGraphBuilder.hpp"
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+//******************************************************************************
+// Construction
+//******************************************************************************
+
+ConcurrentGraphBuilder::ConcurrentGraphBuilder(BidirectedGraph& g_, size_t shard_count) : g(g_) {
+    if (shard_count == 0) shard_count = 4 * ThreadPool::get_instance().get_thread_count();
+    shards.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; i++) {
+        shards.emplace_back(new Shard(g));
+    }
+}
+
+//******************************************************************************
+// Public functions
+//******************************************************************************
+
+void ConcurrentGraphBuilder::add_node(const nid_t& id, const string& sequence) {
+    Shard& shard = get_shard(id);
+    lock_guard<mutex> guard(shard.lock);
+    shard.builder.add_node(id, sequence);
+}
+
+void ConcurrentGraphBuilder::add_edge(const handle_t& left, const handle_t& right) {
+    /// Both entries of the edge go to the left node's shard. The build sorts
+    /// them by node-side anyway.
+    Shard& shard = get_shard(g.get_id(left));
+    lock_guard<mutex> guard(shard.lock);
+    shard.builder.add_edge(left, right);
+}
+
+void ConcurrentGraphBuilder::finalize() {
+    /// A node's additions all went to one shard in order, so the last
+    /// sequence added for an ID still wins after the shards are chained
+    BidirectedGraphBuilder builder(g);
+    for (auto& shard : shards) {
+        lock_guard<mutex> guard(shard->lock);
+        builder.absorb(shard->builder);
+    }
+    builder.finalize();
+}
+
+//******************************************************************************
+// Private functions
+//******************************************************************************
+
+ConcurrentGraphBuilder::Shard& ConcurrentGraphBuilder::get_shard(const nid_t& id) {
+    /// Runs of consecutive IDs share a shard, so a thread adding a stretch of
+    /// the graph keeps taking the same lock while others work elsewhere
+    return *shards[(static_cast<size_t>(id) / SHARD_RUN) % shards.size()];
+}
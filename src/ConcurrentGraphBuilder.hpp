@@ -0,0 +1,64 @@
+#ifndef ConcurrentGraphBuilder_hpp
+#define ConcurrentGraphBuilder_hpp
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BidirectedGraph.hpp"
+#include "BidirectedGraphBuilder.hpp"
+
+using namespace std;
+using namespace handlegraph;
+
+/// Loads nodes and edges into a BidirectedGraph from many threads at once.
+/// Storage is split into shards by node ID, each a BidirectedGraphBuilder
+/// behind its own lock, so producers working on different parts of the graph
+/// (one per chromosome, say) rarely wait on each other. finalize() merges
+/// the shards and builds the graph's usual single-writer storage, which is
+/// then used for analysis as normal.
+///
+///     ConcurrentGraphBuilder builder(g);
+///     // On any number of threads:
+///     builder.add_node(1, "GATT");
+///     builder.add_edge(g.get_handle(1), g.get_handle(2));
+///     // Once every producer is done:
+///     builder.finalize();
+class ConcurrentGraphBuilder {
+    private:
+        /// Number of consecutive IDs mapped to the same shard
+        static constexpr size_t SHARD_RUN = 1024;
+
+        struct Shard {
+            mutex lock;
+            BidirectedGraphBuilder builder;
+
+            Shard(BidirectedGraph& g) : builder(g) {}
+        };
+
+        BidirectedGraph& g;
+        vector<unique_ptr<Shard>> shards;
+
+        /// Returns the shard holding the given node.
+        Shard& get_shard(const nid_t& id);
+
+    public:
+        /// Builder that adds to the given graph when finalized. A shard_count
+        /// of 0 picks four shards per thread in the ThreadPool.
+        ConcurrentGraphBuilder(BidirectedGraph& g_, size_t shard_count = 0);
+
+        /// Adds a node. Thread-safe. If the same ID is added more than once
+        /// the last sequence wins.
+        void add_node(const nid_t& id, const string& sequence);
+
+        /// Adds an edge between the given handles. Thread-safe. Duplicate
+        /// edges are collapsed and edges to nodes that don't exist are dropped.
+        void add_edge(const handle_t& left, const handle_t& right);
+
+        /// Adds everything to the graph and empties the builder. Must not run
+        /// while other threads are still adding.
+        void finalize();
+};
+
+#endif /* ConcurrentGraphBuilder_hpp */
@@ -0,0 +1,205 @@
+#include "FrozenBidirectedGraph.hpp"
+
+#include "handlegraph/util.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+using namespace std;
+
+//******************************************************************************
+// Construction
+//******************************************************************************
+
+FrozenBidirectedGraph::FrozenBidirectedGraph(const HandleGraph& g) {
+    /// Rank nodes by ID
+    ids.reserve(g.get_node_count());
+    g.for_each_handle([&](const handle_t& handle) {
+        ids.push_back(g.get_id(handle));
+    });
+    sort(ids.begin(), ids.end());
+    is_contiguous = ids.empty() ||
+        static_cast<size_t>(ids.back() - ids.front()) + 1 == ids.size();
+
+    /// Count the neighbors of every node-side to size the offsets. One extra
+    /// empty run at the end is what missing nodes resolve to.
+    offsets.assign(2 * ids.size() + 2, 0);
+    seq_offsets.assign(ids.size() + 2, 0);
+    for (size_t rank = 0; rank < ids.size(); rank++) {
+        handle_t handle = g.get_handle(ids[rank]);
+        offsets[2 * rank + 1] = g.get_degree(handle, false);
+        offsets[2 * rank + 2] = g.get_degree(handle, true);
+        seq_offsets[rank + 1] = g.get_length(handle);
+    }
+    for (size_t i = 1; i < offsets.size(); i++) offsets[i] += offsets[i - 1];
+    for (size_t i = 1; i < seq_offsets.size(); i++) seq_offsets[i] += seq_offsets[i - 1];
+
+    /// Fill in the targets of each node-side in one pass
+    targets.resize(offsets.back());
+    arena.reserve(seq_offsets.back());
+    size_t inversions = 0;
+    for (size_t rank = 0; rank < ids.size(); rank++) {
+        handle_t handle = g.get_handle(ids[rank]);
+        for (bool is_reverse : {false, true}) {
+            handle_t side = is_reverse ? g.flip(handle) : handle;
+            size_t pos = offsets[2 * rank + is_reverse];
+            g.follow_edges(side, false, [&](const handle_t& next) {
+                targets[pos++] = next;
+                if (next == g.flip(side)) inversions++;
+            });
+        }
+        arena.append(g.get_sequence(handle));
+    }
+
+    /// Every edge is stored from both of its sides except for inversions,
+    /// whose complement is the edge itself
+    edge_count = (targets.size() + inversions) / 2;
+}
+
+//******************************************************************************
+// Private helpers
+//******************************************************************************
+
+size_t FrozenBidirectedGraph::get_rank(const nid_t& node_id) const {
+    if (ids.empty()) return 0;
+    if (is_contiguous) {
+        if (node_id < ids.front() || node_id > ids.back()) return ids.size();
+        return node_id - ids.front();
+    }
+    auto it = lower_bound(ids.begin(), ids.end(), node_id);
+    if (it == ids.end() || *it != node_id) return ids.size();
+    return it - ids.begin();
+}
+
+SequenceSpan FrozenBidirectedGraph::get_span(size_t rank) const {
+    SequenceSpan span;
+    span.offset = seq_offsets[rank];
+    span.length = seq_offsets[rank + 1] - seq_offsets[rank];
+    return span;
+}
+
+size_t FrozenBidirectedGraph::get_side(const handle_t& handle) const {
+    size_t rank = get_rank(get_id(handle));
+    if (rank == ids.size()) return 2 * rank;
+    return 2 * rank + get_is_reverse(handle);
+}
+
+//******************************************************************************
+// Handle graph public functions
+//******************************************************************************
+
+/// Method to check if a node exists by ID
+bool FrozenBidirectedGraph::has_node(nid_t node_id) const {
+    return get_rank(node_id) < ids.size();
+}
+
+/// Look up the handle for the node with the given ID in the given orientation
+handle_t FrozenBidirectedGraph::get_handle(const nid_t& node_id, bool is_reverse) const {
+    return number_bool_packing::pack(node_id, is_reverse);
+}
+
+/// Get the ID from a handle
+nid_t FrozenBidirectedGraph::get_id(const handle_t& handle) const {
+    return number_bool_packing::unpack_number(handle);
+}
+
+/// Get the orientation of a handle
+bool FrozenBidirectedGraph::get_is_reverse(const handle_t& handle) const {
+    return number_bool_packing::unpack_bit(handle);
+}
+
+/// Invert the orientation of a handle (potentially without getting its ID)
+handle_t FrozenBidirectedGraph::flip(const handle_t& handle) const {
+    return number_bool_packing::toggle_bit(handle);
+}
+
+/// Get the length of a node
+size_t FrozenBidirectedGraph::get_length(const handle_t& handle) const {
+    return get_span(get_rank(get_id(handle))).length;
+}
+
+/// Get the sequence of a node, presented in the handle's local forward
+/// orientation.
+string FrozenBidirectedGraph::get_sequence(const handle_t& handle) const {
+    string sequence;
+    arena.decode(get_span(get_rank(get_id(handle))), get_is_reverse(handle), sequence);
+    return sequence;
+}
+
+/// Get a single base of a node in the handle's local forward orientation.
+char FrozenBidirectedGraph::get_base(const handle_t& handle, size_t index) const {
+    SequenceSpan span = get_span(get_rank(get_id(handle)));
+    if (get_is_reverse(handle)) {
+        return reverse_complement(arena.get_base(span, span.length - index - 1));
+    }
+    return arena.get_base(span, index);
+}
+
+/// Get a substring of a node's sequence in the handle's local forward
+/// orientation.
+string FrozenBidirectedGraph::get_subsequence(const handle_t& handle, size_t index, size_t size) const {
+    SequenceSpan span = get_span(get_rank(get_id(handle)));
+    return arena.view(span, get_is_reverse(handle)).substr(index, size).str();
+}
+
+/// Return the number of nodes in the graph
+size_t FrozenBidirectedGraph::get_node_count() const {
+    return ids.size();
+}
+
+/// Return the smallest ID in the graph, or some smaller number if the
+/// smallest ID is unavailable. Return value is unspecified if the graph is empty.
+nid_t FrozenBidirectedGraph::min_node_id() const {
+    return ids.empty() ? 0 : ids.front();
+}
+
+/// Return the largest ID in the graph, or some larger number if the
+/// largest ID is unavailable. Return value is unspecified if the graph is empty.
+nid_t FrozenBidirectedGraph::max_node_id() const {
+    return ids.empty() ? 0 : ids.back();
+}
+
+size_t FrozenBidirectedGraph::get_degree(const handle_t& handle, bool go_left) const {
+    size_t side = get_side(go_left ? flip(handle) : handle);
+    return offsets[side + 1] - offsets[side];
+}
+
+bool FrozenBidirectedGraph::has_edge(const handle_t& left, const handle_t& right) const {
+    if (!has_node(get_id(left))) return false;
+    size_t side = get_side(left);
+    auto begin = targets.begin() + offsets[side];
+    auto end = targets.begin() + offsets[side + 1];
+    return find(begin, end, right) != end;
+}
+
+size_t FrozenBidirectedGraph::get_edge_count() const {
+    return edge_count;
+}
+
+//******************************************************************************
+// Handle graph protected functions
+//******************************************************************************
+
+bool FrozenBidirectedGraph::follow_edges_impl(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const {
+    /// Node-side whose neighbors are reached by walking in this direction
+    size_t side = get_side(go_left ? flip(handle) : handle);
+
+    for (size_t i = offsets[side]; i < offsets[side + 1]; i++) {
+        if (!iteratee(go_left ? flip(targets[i]) : targets[i])) return false;
+    }
+    return true;
+}
+
+bool FrozenBidirectedGraph::for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel) const {
+    /// Nothing changes after construction, so the IDs can always be split
+    /// across the thread pool
+    if (parallel) {
+        return ThreadPool::get_instance().parallel_for(ids.size(), [&](size_t rank) {
+            return iteratee(get_handle(ids[rank]));
+        });
+    }
+
+    for (const nid_t& id : ids) {
+        if (!iteratee(get_handle(id))) return false;
+    }
+    return true;
+}
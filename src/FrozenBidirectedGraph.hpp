@@ -0,0 +1,123 @@
+#ifndef FrozenBidirectedGraph_hpp
+#define FrozenBidirectedGraph_hpp
+
+/* Data structures for internal representation */
+#include <vector>
+#include <string>
+
+/* Handlegraph includes */
+#include "algorithms/handle.hpp"
+
+#include "SequenceArena.hpp"
+
+using namespace std;
+using namespace handlegraph;
+
+/// Read-only snapshot of a HandleGraph laid out for analysis passes.
+/// Nodes are ranked by ID and every node-side's neighbors are stored in one
+/// contiguous run of a shared targets array (compressed sparse row), so
+/// following edges is a linear scan instead of a hash lookup. Handles are
+/// interchangeable with the BidirectedGraph the snapshot was built from.
+class FrozenBidirectedGraph : public HandleGraph {
+    private:
+        /// Node IDs in ascending order. A node's index is its rank.
+        vector<nid_t> ids;
+        /// True if ids is a contiguous range so rank = id - ids.front().
+        bool is_contiguous = true;
+
+        /// Node-side i = 2 * rank + is_reverse owns targets[offsets[i]..offsets[i + 1]).
+        vector<size_t> offsets;
+        vector<handle_t> targets;
+
+        /// Sequence of the node with rank i is packed in the arena at
+        /// [seq_offsets[i], seq_offsets[i + 1]).
+        SequenceArena arena;
+        vector<size_t> seq_offsets;
+
+        /// Number of distinct edges.
+        size_t edge_count = 0;
+
+        /// Returns the rank of the node or ids.size() if it doesn't exist.
+        size_t get_rank(const nid_t& node_id) const;
+
+        /// Returns where the sequence of the node with the given rank is stored.
+        SequenceSpan get_span(size_t rank) const;
+
+        /// Returns the node-side index of the handle (go_left = false side).
+        /// Nodes that don't exist map to an empty node-side.
+        size_t get_side(const handle_t& handle) const;
+
+    public:
+        FrozenBidirectedGraph() = default;
+
+        /// Builds a frozen copy of the given graph.
+        FrozenBidirectedGraph(const HandleGraph& g);
+
+        /// Method to check if a node exists by ID
+        bool has_node(nid_t node_id) const;
+
+        /// Look up the handle for the node with the given ID in the given orientation
+        handle_t get_handle(const nid_t& node_id, bool is_reverse = false) const;
+
+        /// Get the ID from a handle
+        nid_t get_id(const handle_t& handle) const;
+
+        /// Get the orientation of a handle
+        bool get_is_reverse(const handle_t& handle) const;
+
+        /// Invert the orientation of a handle (potentially without getting its ID)
+        handle_t flip(const handle_t& handle) const;
+
+        /// Get the length of a node
+        size_t get_length(const handle_t& handle) const;
+
+        /// Get the sequence of a node, presented in the handle's local forward
+        /// orientation.
+        string get_sequence(const handle_t& handle) const;
+
+        /// Get a single base of a node in the handle's local forward orientation.
+        char get_base(const handle_t& handle, size_t index) const;
+
+        /// Get a substring of a node's sequence in the handle's local forward
+        /// orientation, decoding only the requested bases.
+        string get_subsequence(const handle_t& handle, size_t index, size_t size) const;
+
+        /// Return the number of nodes in the graph
+        size_t get_node_count() const;
+
+        /// Return the smallest ID in the graph, or some smaller number if the
+        /// smallest ID is unavailable. Return value is unspecified if the graph is empty.
+        nid_t min_node_id() const;
+
+        /// Return the largest ID in the graph, or some larger number if the
+        /// largest ID is unavailable. Return value is unspecified if the graph is empty.
+        nid_t max_node_id() const;
+
+        /// Get the number of edges on the right (go_left = false) or left (go_left
+        /// = true) side of the given handle.
+        size_t get_degree(const handle_t& handle, bool go_left) const;
+
+        /// Returns true if there is an edge that allows traversal from the left
+        /// handle to the right handle.
+        bool has_edge(const handle_t& left, const handle_t& right) const;
+        using HandleGraph::has_edge;
+
+        /// Return the total number of edges in the graph.
+        size_t get_edge_count() const;
+
+    protected:
+
+        /// Loop over all the handles to next/previous (right/left) nodes. Passes
+        /// them to a callback which returns false to stop iterating and true to
+        /// continue. Returns true if we finished and false if we stopped early.
+        bool follow_edges_impl(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const;
+
+        /// Loop over all the nodes in the graph in their local forward
+        /// orientations, in their internal stored order. Stop if the iteratee
+        /// returns false. Can be told to run in parallel, in which case stopping
+        /// after a false return value is on a best-effort basis and iteration
+        /// order is not defined. Returns true if we finished and false if we
+        /// stopped early.
+        bool for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel = false) const;
+};
+#endif /* FrozenBidirectedGraph_hpp */
@@ -0,0 +1,321 @@
+#include "JsonGraphReader.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+using namespace std;
+
+//******************************************************************************
+// Public functions
+//******************************************************************************
+
+bool JsonGraphReader::read(const node_callback_t& on_node, const edge_callback_t& on_edge) {
+    return read_graph(true, [&](const nid_t& id) { on_node(id, sequence); }, on_edge);
+}
+
+bool JsonGraphReader::read_lengths(const node_length_callback_t& on_node, const edge_callback_t& on_edge) {
+    return read_graph(false, [&](const nid_t& id) { on_node(id, sequence_length); }, on_edge);
+}
+
+//******************************************************************************
+// Private functions
+//******************************************************************************
+
+bool JsonGraphReader::read_graph(bool keep_sequence, const function<void(const nid_t&)>& on_node, const edge_callback_t& on_edge) {
+    error_message.clear();
+    try {
+        skip_space();
+        if (peek() != '{') fail("expected a JSON object");
+        read_object([&]() {
+            if (key == "node") {
+                read_array([&]() { read_node(keep_sequence, on_node); });
+            } else if (key == "edge") {
+                read_array([&]() { read_edge(on_edge); });
+            } else {
+                skip_value();
+            }
+        });
+    } catch (const runtime_error& e) {
+        error_message = e.what();
+        return false;
+    }
+    return true;
+}
+
+int JsonGraphReader::peek() {
+    if (pos == end) {
+        if (!in) return EOF;
+        in.read(buffer.data(), buffer.size());
+        pos = 0;
+        end = in.gcount();
+        if (end == 0) return EOF;
+    }
+    return static_cast<unsigned char>(buffer[pos]);
+}
+
+int JsonGraphReader::get() {
+    int c = peek();
+    if (c == EOF) return c;
+    pos++;
+    if (c == '\n') line++;
+    return c;
+}
+
+void JsonGraphReader::fail(const string& message) const {
+    throw runtime_error("Line " + to_string(line) + ": " + message);
+}
+
+void JsonGraphReader::skip_space() {
+    while (true) {
+        int c = peek();
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            get();
+        } else if (c == '/') {
+            get();
+            int kind = get();
+            if (kind == '/') {
+                while ((c = get()) != EOF && c != '\n') {}
+            } else if (kind == '*') {
+                int last = 0;
+                while ((c = get()) != EOF && !(last == '*' && c == '/')) last = c;
+                if (c == EOF) fail("unterminated comment");
+            } else {
+                fail("unexpected '/'");
+            }
+        } else {
+            return;
+        }
+    }
+}
+
+void JsonGraphReader::expect(char c) {
+    skip_space();
+    int got = get();
+    if (got != c) {
+        fail(string("expected '") + c + "'" + (got == EOF ? " before end of input" : ""));
+    }
+}
+
+void JsonGraphReader::read_string(string& out) {
+    out.clear();
+    expect('"');
+    while (true) {
+        int c = get();
+        if (c == EOF) fail("unterminated string");
+        if (c == '"') return;
+        if (c != '\\') {
+            out.push_back(static_cast<char>(c));
+            continue;
+        }
+
+        c = get();
+        switch (c) {
+            case '"': case '\\': case '/': out.push_back(static_cast<char>(c)); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u': {
+                auto read_hex = [&]() {
+                    unsigned int value = 0;
+                    for (int i = 0; i < 4; i++) {
+                        int digit = get();
+                        if (!isxdigit(digit)) fail("bad \\u escape");
+                        value = value * 16 + (isdigit(digit) ? digit - '0' : (tolower(digit) - 'a' + 10));
+                    }
+                    return value;
+                };
+                unsigned int code = read_hex();
+                /// Combine a surrogate pair
+                if (code >= 0xD800 && code < 0xDC00) {
+                    if (get() != '\\' || get() != 'u') fail("unpaired surrogate in string");
+                    unsigned int low = read_hex();
+                    if (low < 0xDC00 || low >= 0xE000) fail("unpaired surrogate in string");
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                /// Encode as UTF-8
+                if (code < 0x80) {
+                    out.push_back(static_cast<char>(code));
+                } else if (code < 0x800) {
+                    out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+                    out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                } else if (code < 0x10000) {
+                    out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+                    out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                    out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                } else {
+                    out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+                    out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+                    out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                    out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                }
+                break;
+            }
+            default: fail("bad escape in string");
+        }
+    }
+}
+
+size_t JsonGraphReader::skip_string() {
+    expect('"');
+    size_t length = 0;
+    while (true) {
+        /// Scan the buffered run directly; only quotes, escapes and line
+        /// breaks need a closer look
+        size_t run = pos;
+        while (run < end && buffer[run] != '"' && buffer[run] != '\\' && buffer[run] != '\n') run++;
+        length += run - pos;
+        pos = run;
+
+        int c = get();
+        if (c == EOF) fail("unterminated string");
+        if (c == '"') return length;
+        if (c == '\\') {
+            c = get();
+            if (c == EOF) fail("unterminated string");
+            if (c == 'u') {
+                for (int i = 0; i < 4; i++) {
+                    if (!isxdigit(get())) fail("bad \\u escape");
+                }
+            }
+        }
+        length++;
+    }
+}
+
+char JsonGraphReader::read_scalar() {
+    skip_space();
+    int c = peek();
+    if (c == '"') {
+        read_string(text);
+        return '"';
+    }
+
+    /// Numbers and literals run until the next delimiter
+    text.clear();
+    while ((c = peek()) != EOF && (isalnum(c) || c == '-' || c == '+' || c == '.')) {
+        text.push_back(static_cast<char>(get()));
+    }
+    if (text.empty()) fail(c == EOF ? "unexpected end of input" : string("unexpected '") + static_cast<char>(c) + "'");
+    if (text == "true" || text == "false" || text == "null") return text[0];
+    char* rest;
+    strtod(text.c_str(), &rest);
+    if (!(isdigit(text[0]) || text[0] == '-') || *rest != '\0') fail("bad value '" + text + "'");
+    return '0';
+}
+
+void JsonGraphReader::skip_value() {
+    skip_space();
+    int c = peek();
+    if (c == '{') {
+        read_object([&]() { skip_value(); });
+    } else if (c == '[') {
+        read_array([&]() { skip_value(); });
+    } else {
+        read_scalar();
+    }
+}
+
+void JsonGraphReader::read_object(const function<void()>& on_member) {
+    expect('{');
+    skip_space();
+    if (peek() == '}') {
+        get();
+        return;
+    }
+    while (true) {
+        read_string(key);
+        expect(':');
+        on_member();
+        skip_space();
+        int c = get();
+        if (c == '}') return;
+        if (c != ',') fail("expected ',' or '}'");
+    }
+}
+
+void JsonGraphReader::read_array(const function<void()>& on_item) {
+    expect('[');
+    skip_space();
+    if (peek() == ']') {
+        get();
+        return;
+    }
+    while (true) {
+        on_item();
+        skip_space();
+        int c = get();
+        if (c == ']') return;
+        if (c != ',') fail("expected ',' or ']'");
+    }
+}
+
+nid_t JsonGraphReader::read_id() {
+    char kind = read_scalar();
+    if (kind != '0' && kind != '"') fail("bad node ID '" + text + "'");
+    char* rest;
+    nid_t id = strtoll(text.c_str(), &rest, 10);
+    if (rest == text.c_str()) fail("bad node ID '" + text + "'");
+    return id;
+}
+
+bool JsonGraphReader::read_flag() {
+    char kind = read_scalar();
+    if (kind == '"') fail("expected a boolean");
+    return kind == 't' || (kind == '0' && strtod(text.c_str(), nullptr) != 0);
+}
+
+void JsonGraphReader::read_node(bool keep_sequence, const function<void(const nid_t&)>& on_node) {
+    nid_t id = 0;
+    bool has_id = false;
+    sequence.clear();
+    sequence_length = 0;
+    read_object([&]() {
+        if (key == "id") {
+            id = read_id();
+            has_id = true;
+        } else if (key == "sequence") {
+            skip_space();
+            if (peek() == '"') {
+                if (keep_sequence) {
+                    read_string(sequence);
+                } else {
+                    sequence_length = skip_string();
+                }
+            } else if (read_scalar() != 'n') {
+                fail("expected a sequence string");
+            }
+        } else {
+            skip_value();
+        }
+    });
+    if (!has_id) fail("node without an ID");
+    on_node(id);
+}
+
+void JsonGraphReader::read_edge(const edge_callback_t& on_edge) {
+    nid_t from = 0;
+    nid_t to = 0;
+    bool has_from = false;
+    bool has_to = false;
+    bool from_start = false;
+    bool to_end = false;
+    read_object([&]() {
+        if (key == "from") {
+            from = read_id();
+            has_from = true;
+        } else if (key == "to") {
+            to = read_id();
+            has_to = true;
+        } else if (key == "from_start") {
+            from_start = read_flag();
+        } else if (key == "to_end") {
+            to_end = read_flag();
+        } else {
+            skip_value();
+        }
+    });
+    if (!has_from || !has_to) fail("edge without both ends");
+    on_edge(from, from_start, to, to_end);
+}
@@ -0,0 +1,104 @@
+#ifndef JsonGraphReader_hpp
+#define JsonGraphReader_hpp
+
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+/* Handlegraph includes */
+#include "algorithms/handle.hpp"
+
+using namespace std;
+using namespace handlegraph;
+
+/// Streaming reader for vg JSON graphs.
+/// The input is scanned once through a fixed-size buffer and every node and
+/// edge is handed on as soon as its object has been read, so no document
+/// tree is built and memory use doesn't grow with the file. Members other
+/// than the "node" and "edge" arrays are skipped. IDs may be integers or
+/// strings, and from_start/to_end default to false. Comments are allowed
+/// and anything after the top-level object is ignored, like the jsoncpp
+/// reader this replaces.
+///
+///     JsonGraphReader reader(infile);
+///     bool ok = reader.read(
+///         [&](const nid_t& id, const string& sequence) { ... },
+///         [&](const nid_t& from, bool from_start, const nid_t& to, bool to_end) { ... });
+class JsonGraphReader {
+    public:
+        using node_callback_t = function<void(const nid_t&, const string&)>;
+        using edge_callback_t = function<void(const nid_t&, bool, const nid_t&, bool)>;
+        using node_length_callback_t = function<void(const nid_t&, size_t)>;
+
+    private:
+        istream& in;
+        vector<char> buffer;
+        size_t pos = 0;
+        size_t end = 0;
+        size_t line = 1;
+        string error_message;
+
+        /// Scratch for the current key and scalar value
+        string key;
+        string text;
+        string sequence;
+        size_t sequence_length = 0;
+
+        static const size_t BUFFER_SIZE = 1 << 16;
+
+        /// Returns the next character without consuming it, or EOF.
+        int peek();
+        /// Consumes and returns the next character, or EOF.
+        int get();
+        /// Throws a runtime_error naming the current line.
+        [[noreturn]] void fail(const string& message) const;
+
+        /// Skips whitespace and comments.
+        void skip_space();
+        /// Consumes the next non-space character, which must be c.
+        void expect(char c);
+        /// Reads a string literal into out.
+        void read_string(string& out);
+        /// Skips a string literal and returns its length, counting each
+        /// escape as one character.
+        size_t skip_string();
+        /// Reads a number, string, boolean or null into text. Returns the
+        /// first character of the value (e.g. '"' for strings).
+        char read_scalar();
+        /// Skips over any value.
+        void skip_value();
+
+        /// Calls on_member with key set for each member of an object. The
+        /// callback must consume the member's value.
+        void read_object(const function<void()>& on_member);
+        /// Calls on_item for each element of an array. The callback must
+        /// consume the element.
+        void read_array(const function<void()>& on_item);
+
+        nid_t read_id();
+        bool read_flag();
+        /// Reads a node into sequence, or only sequence_length if
+        /// keep_sequence is false, and calls on_node with its ID.
+        void read_node(bool keep_sequence, const function<void(const nid_t&)>& on_node);
+        void read_edge(const edge_callback_t& on_edge);
+        bool read_graph(bool keep_sequence, const function<void(const nid_t&)>& on_node, const edge_callback_t& on_edge);
+
+    public:
+        JsonGraphReader(istream& in_) : in(in_), buffer(BUFFER_SIZE) {}
+
+        /// Reads the graph, calling on_node for every node and on_edge for
+        /// every edge in the order they appear. Returns false if the input
+        /// isn't a vg JSON graph, in which case error() says why and some
+        /// callbacks may already have run.
+        bool read(const node_callback_t& on_node, const edge_callback_t& on_edge);
+
+        /// Like read, but sequences are only scanned for their lengths,
+        /// which are passed to on_node instead.
+        bool read_lengths(const node_length_callback_t& on_node, const edge_callback_t& on_edge);
+
+        /// Description of the last error.
+        const string& error() const { return error_message; }
+};
+
+#endif /* JsonGraphReader_hpp */
@@ -0,0 +1,344 @@
+#include "MappedBidirectedGraph.hpp"
+
+#include "handlegraph/util.hpp"
+#include "ThreadPool.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <utility>
+#include <vector>
+using namespace std;
+
+const char MappedBidirectedGraph::MAGIC[8] = {'B', 'D', 'G', 'R', 'A', 'P', 'H', '\0'};
+
+static const char BASES[] = {'A', 'C', 'G', 'T'};
+
+//******************************************************************************
+// Writing
+//******************************************************************************
+
+bool MappedBidirectedGraph::write(const HandleGraph& g, ostream& out) {
+    /// Rank nodes by ID
+    vector<nid_t> node_ids;
+    node_ids.reserve(g.get_node_count());
+    g.for_each_handle([&](const handle_t& handle) {
+        node_ids.push_back(g.get_id(handle));
+    });
+    sort(node_ids.begin(), node_ids.end());
+    size_t n = node_ids.size();
+
+    /// Size the node-side runs and sequences, and find the bases that don't
+    /// pack. One extra empty run at the end is what missing nodes resolve to.
+    vector<uint64_t> side_offsets(2 * n + 2, 0);
+    vector<uint64_t> base_offsets(n + 2, 0);
+    vector<uint64_t> positions;
+    string bases;
+    string sequence;
+    for (size_t rank = 0; rank < n; rank++) {
+        handle_t handle = g.get_handle(node_ids[rank]);
+        side_offsets[2 * rank + 1] = side_offsets[2 * rank] + g.get_degree(handle, false);
+        side_offsets[2 * rank + 2] = side_offsets[2 * rank + 1] + g.get_degree(handle, true);
+        sequence = g.get_sequence(handle);
+        for (size_t i = 0; i < sequence.size(); i++) {
+            if (find(BASES, BASES + 4, sequence[i]) == BASES + 4) {
+                positions.push_back(base_offsets[rank] + i);
+                bases.push_back(sequence[i]);
+            }
+        }
+        base_offsets[rank + 1] = base_offsets[rank] + sequence.size();
+    }
+    side_offsets[2 * n + 1] = side_offsets[2 * n];
+    base_offsets[n + 1] = base_offsets[n];
+
+    FileHeader file_header = {};
+    memcpy(file_header.magic, MAGIC, sizeof(MAGIC));
+    file_header.version = VERSION;
+    file_header.endian_mark = ENDIAN_MARK;
+    file_header.node_count = n;
+    file_header.edge_count = g.get_edge_count();
+    file_header.target_count = side_offsets.back();
+    file_header.base_count = base_offsets.back();
+    file_header.exception_count = positions.size();
+
+    auto write_bytes = [&](const void* data, size_t size) {
+        out.write(static_cast<const char*>(data), size);
+    };
+    write_bytes(&file_header, sizeof(file_header));
+    write_bytes(node_ids.data(), n * sizeof(nid_t));
+    write_bytes(side_offsets.data(), side_offsets.size() * sizeof(uint64_t));
+
+    /// Stream the neighbors and the packed bases node by node, a buffer at a time
+    vector<uint64_t> buffer;
+    auto flush = [&](size_t limit) {
+        if (buffer.size() < limit) return;
+        write_bytes(buffer.data(), buffer.size() * sizeof(uint64_t));
+        buffer.clear();
+    };
+    for (size_t rank = 0; rank < n; rank++) {
+        handle_t handle = g.get_handle(node_ids[rank]);
+        for (handle_t side : {handle, g.flip(handle)}) {
+            g.follow_edges(side, false, [&](const handle_t& next) {
+                buffer.push_back(as_integer(next));
+            });
+        }
+        flush(1 << 16);
+    }
+    flush(0);
+    write_bytes(base_offsets.data(), base_offsets.size() * sizeof(uint64_t));
+
+    uint64_t word = 0;
+    size_t packed = 0;
+    for (size_t rank = 0; rank < n; rank++) {
+        sequence = g.get_sequence(g.get_handle(node_ids[rank]));
+        for (char base : sequence) {
+            const char* code = find(BASES, BASES + 4, base);
+            if (code != BASES + 4) word |= static_cast<uint64_t>(code - BASES) << (2 * (packed % 32));
+            if (++packed % 32 == 0) {
+                buffer.push_back(word);
+                word = 0;
+            }
+        }
+        flush(1 << 16);
+    }
+    if (packed % 32) buffer.push_back(word);
+    flush(0);
+
+    write_bytes(positions.data(), positions.size() * sizeof(uint64_t));
+    write_bytes(bases.data(), bases.size());
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+//******************************************************************************
+// Mapping
+//******************************************************************************
+
+MappedBidirectedGraph::~MappedBidirectedGraph() {
+    close();
+}
+
+bool MappedBidirectedGraph::open(const string& filename) {
+    close();
+
+    auto fail = [&](const string& message) {
+        cerr << "Error: " << filename << ": " << message << endl;
+        close();
+        return false;
+    };
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return fail("can't open file");
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return fail("can't stat file");
+    }
+    mapping_size = info.st_size;
+    if (mapping_size < sizeof(FileHeader)) {
+        ::close(fd);
+        return fail("not a binary graph");
+    }
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        return fail("can't map file");
+    }
+
+    header = static_cast<const FileHeader*>(mapping);
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) return fail("not a binary graph");
+    if (header->version != VERSION) return fail("unsupported binary graph version " + to_string(header->version));
+    if (header->endian_mark != ENDIAN_MARK) return fail("binary graph was written with another byte order");
+
+    /// Lay the arrays out over the mapping, checking that they fit
+    uint64_t n = header->node_count;
+    uint64_t word_count = (header->base_count + 31) / 32;
+    uint64_t words_needed = n + (2 * n + 2) + header->target_count + (n + 2) + word_count + header->exception_count;
+    uint64_t available = (mapping_size - sizeof(FileHeader)) / sizeof(uint64_t);
+    if (n > available || header->target_count > available || word_count > available ||
+        header->exception_count > available || words_needed > available ||
+        sizeof(FileHeader) + words_needed * sizeof(uint64_t) + header->exception_count > mapping_size) {
+        return fail("binary graph is truncated");
+    }
+    const uint64_t* next = reinterpret_cast<const uint64_t*>(header + 1);
+    ids = reinterpret_cast<const nid_t*>(next);
+    next += n;
+    offsets = next;
+    next += 2 * n + 2;
+    targets = reinterpret_cast<const handle_t*>(next);
+    next += header->target_count;
+    seq_offsets = next;
+    next += n + 2;
+    words = next;
+    next += word_count;
+    exception_positions = next;
+    next += header->exception_count;
+    exception_bases = reinterpret_cast<const char*>(next);
+
+    node_count = n;
+    is_contiguous = n == 0 || static_cast<uint64_t>(ids[n - 1] - ids[0]) + 1 == n;
+    return true;
+}
+
+void MappedBidirectedGraph::close() {
+    if (mapping) munmap(mapping, mapping_size);
+    mapping = nullptr;
+    mapping_size = 0;
+    header = nullptr;
+    node_count = 0;
+    is_contiguous = true;
+}
+
+//******************************************************************************
+// Private helpers
+//******************************************************************************
+
+size_t MappedBidirectedGraph::get_rank(const nid_t& node_id) const {
+    if (node_count == 0) return 0;
+    if (is_contiguous) {
+        if (node_id < ids[0] || node_id > ids[node_count - 1]) return node_count;
+        return node_id - ids[0];
+    }
+    const nid_t* it = lower_bound(ids, ids + node_count, node_id);
+    if (it == ids + node_count || *it != node_id) return node_count;
+    return it - ids;
+}
+
+size_t MappedBidirectedGraph::get_side(const handle_t& handle) const {
+    size_t rank = get_rank(get_id(handle));
+    if (rank == node_count) return 2 * rank;
+    return 2 * rank + get_is_reverse(handle);
+}
+
+char MappedBidirectedGraph::get_packed_base(size_t pos) const {
+    return BASES[(words[pos / 32] >> (2 * (pos % 32))) & 3];
+}
+
+//******************************************************************************
+// Handle graph public functions
+//******************************************************************************
+
+/// Method to check if a node exists by ID
+bool MappedBidirectedGraph::has_node(nid_t node_id) const {
+    return get_rank(node_id) < node_count;
+}
+
+/// Look up the handle for the node with the given ID in the given orientation
+handle_t MappedBidirectedGraph::get_handle(const nid_t& node_id, bool is_reverse) const {
+    return number_bool_packing::pack(node_id, is_reverse);
+}
+
+/// Get the ID from a handle
+nid_t MappedBidirectedGraph::get_id(const handle_t& handle) const {
+    return number_bool_packing::unpack_number(handle);
+}
+
+/// Get the orientation of a handle
+bool MappedBidirectedGraph::get_is_reverse(const handle_t& handle) const {
+    return number_bool_packing::unpack_bit(handle);
+}
+
+/// Invert the orientation of a handle (potentially without getting its ID)
+handle_t MappedBidirectedGraph::flip(const handle_t& handle) const {
+    return number_bool_packing::toggle_bit(handle);
+}
+
+/// Get the length of a node
+size_t MappedBidirectedGraph::get_length(const handle_t& handle) const {
+    if (node_count == 0) return 0;
+    size_t rank = get_rank(get_id(handle));
+    return seq_offsets[rank + 1] - seq_offsets[rank];
+}
+
+/// Get the sequence of a node, presented in the handle's local forward
+/// orientation.
+string MappedBidirectedGraph::get_sequence(const handle_t& handle) const {
+    if (node_count == 0) return string();
+    size_t rank = get_rank(get_id(handle));
+    uint64_t begin = seq_offsets[rank];
+    uint64_t end = seq_offsets[rank + 1];
+
+    string sequence(end - begin, 'A');
+    for (uint64_t pos = begin; pos < end; pos++) sequence[pos - begin] = get_packed_base(pos);
+
+    /// Patch in the bases that weren't packed
+    const uint64_t* last = exception_positions + header->exception_count;
+    for (const uint64_t* it = lower_bound(exception_positions, last, begin); it != last && *it < end; it++) {
+        sequence[*it - begin] = exception_bases[it - exception_positions];
+    }
+
+    if (get_is_reverse(handle)) reverse_complement_in_place(sequence);
+    return sequence;
+}
+
+/// Return the number of nodes in the graph
+size_t MappedBidirectedGraph::get_node_count() const {
+    return node_count;
+}
+
+/// Return the smallest ID in the graph, or some smaller number if the
+/// smallest ID is unavailable. Return value is unspecified if the graph is empty.
+nid_t MappedBidirectedGraph::min_node_id() const {
+    return node_count == 0 ? 0 : ids[0];
+}
+
+/// Return the largest ID in the graph, or some larger number if the
+/// largest ID is unavailable. Return value is unspecified if the graph is empty.
+nid_t MappedBidirectedGraph::max_node_id() const {
+    return node_count == 0 ? 0 : ids[node_count - 1];
+}
+
+size_t MappedBidirectedGraph::get_degree(const handle_t& handle, bool go_left) const {
+    if (node_count == 0) return 0;
+    size_t side = get_side(go_left ? flip(handle) : handle);
+    return offsets[side + 1] - offsets[side];
+}
+
+bool MappedBidirectedGraph::has_edge(const handle_t& left, const handle_t& right) const {
+    if (!has_node(get_id(left))) return false;
+    size_t side = get_side(left);
+    const handle_t* begin = targets + offsets[side];
+    const handle_t* end = targets + offsets[side + 1];
+    return find(begin, end, right) != end;
+}
+
+size_t MappedBidirectedGraph::get_edge_count() const {
+    return header ? header->edge_count : 0;
+}
+
+//******************************************************************************
+// Handle graph protected functions
+//******************************************************************************
+
+bool MappedBidirectedGraph::follow_edges_impl(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const {
+    if (node_count == 0) return true;
+
+    /// Node-side whose neighbors are reached by walking in this direction
+    size_t side = get_side(go_left ? flip(handle) : handle);
+
+    for (uint64_t i = offsets[side]; i < offsets[side + 1]; i++) {
+        if (!iteratee(go_left ? flip(targets[i]) : targets[i])) return false;
+    }
+    return true;
+}
+
+bool MappedBidirectedGraph::for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel) const {
+    /// The mapping is read-only, so the ranks can be split across the
+    /// thread pool
+    if (parallel) {
+        return ThreadPool::get_instance().parallel_for(node_count, [&](size_t rank) {
+            return iteratee(get_handle(ids[rank]));
+        });
+    }
+
+    for (size_t rank = 0; rank < node_count; rank++) {
+        if (!iteratee(get_handle(ids[rank]))) return false;
+    }
+    return true;
+}
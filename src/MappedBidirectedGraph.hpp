@@ -0,0 +1,154 @@
+#ifndef MappedBidirectedGraph_hpp
+#define MappedBidirectedGraph_hpp
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/* Handlegraph includes */
+#include "algorithms/handle.hpp"
+
+using namespace std;
+using namespace handlegraph;
+
+/// Read-only graph served directly from a memory-mapped binary graph file.
+/// The file holds the same arrays as a FrozenBidirectedGraph, already laid
+/// out, so opening one only maps it and checks its header. Pages are read
+/// in as they are touched and shared between every process mapping the
+/// same file. Handles are interchangeable with the graph that was written.
+///
+/// File layout (version 1, native byte order, 8-byte words):
+///
+///     header                  FileHeader, 64 bytes
+///     ids[n]                  node IDs in ascending order; rank = index
+///     offsets[2n + 2]         node-side 2 * rank + is_reverse owns
+///                             targets[offsets[i]..offsets[i + 1])
+///     targets[t]              neighbors reached going right from each side
+///     seq_offsets[n + 2]      sequence of rank i is bases
+///                             [seq_offsets[i], seq_offsets[i + 1])
+///     words[(b + 31) / 32]    bases packed 2 bits each (A, C, G, T)
+///     exception_positions[e]  positions of bases that aren't ACGT, sorted
+///     exception_bases[e]      the characters at those positions
+class MappedBidirectedGraph : public HandleGraph {
+    private:
+        struct FileHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t endian_mark;
+            uint64_t node_count;
+            uint64_t edge_count;
+            uint64_t target_count;
+            uint64_t base_count;
+            uint64_t exception_count;
+            uint64_t reserved;
+        };
+
+        static const char MAGIC[8];
+        static const uint32_t VERSION = 1;
+        static const uint32_t ENDIAN_MARK = 0x01020304;
+
+        /// The mapping, and the arrays inside it
+        void* mapping = nullptr;
+        size_t mapping_size = 0;
+        const FileHeader* header = nullptr;
+        const nid_t* ids = nullptr;
+        const uint64_t* offsets = nullptr;
+        const handle_t* targets = nullptr;
+        const uint64_t* seq_offsets = nullptr;
+        const uint64_t* words = nullptr;
+        const uint64_t* exception_positions = nullptr;
+        const char* exception_bases = nullptr;
+
+        size_t node_count = 0;
+        /// True if the IDs are a contiguous range so rank = id - ids[0].
+        bool is_contiguous = true;
+
+        /// Returns the rank of the node or node_count if it doesn't exist.
+        size_t get_rank(const nid_t& node_id) const;
+
+        /// Returns the node-side index of the handle (go_left = false side).
+        /// Nodes that don't exist map to an empty node-side.
+        size_t get_side(const handle_t& handle) const;
+
+        /// Returns the forward base at the given position of the packed sequences.
+        char get_packed_base(size_t pos) const;
+
+    public:
+        MappedBidirectedGraph() = default;
+        MappedBidirectedGraph(const MappedBidirectedGraph&) = delete;
+        MappedBidirectedGraph& operator=(const MappedBidirectedGraph&) = delete;
+        ~MappedBidirectedGraph();
+
+        /// Writes the graph in the binary format. Returns false if the stream
+        /// failed.
+        static bool write(const HandleGraph& g, ostream& out);
+
+        /// Maps the given binary graph file, replacing any file mapped
+        /// before. Returns false, leaving the graph empty, if the file can't
+        /// be mapped or isn't a binary graph of this version.
+        bool open(const string& filename);
+
+        /// Unmaps the file, leaving the graph empty.
+        void close();
+
+        /// Method to check if a node exists by ID
+        bool has_node(nid_t node_id) const;
+
+        /// Look up the handle for the node with the given ID in the given orientation
+        handle_t get_handle(const nid_t& node_id, bool is_reverse = false) const;
+
+        /// Get the ID from a handle
+        nid_t get_id(const handle_t& handle) const;
+
+        /// Get the orientation of a handle
+        bool get_is_reverse(const handle_t& handle) const;
+
+        /// Invert the orientation of a handle (potentially without getting its ID)
+        handle_t flip(const handle_t& handle) const;
+
+        /// Get the length of a node
+        size_t get_length(const handle_t& handle) const;
+
+        /// Get the sequence of a node, presented in the handle's local forward
+        /// orientation.
+        string get_sequence(const handle_t& handle) const;
+
+        /// Return the number of nodes in the graph
+        size_t get_node_count() const;
+
+        /// Return the smallest ID in the graph, or some smaller number if the
+        /// smallest ID is unavailable. Return value is unspecified if the graph is empty.
+        nid_t min_node_id() const;
+
+        /// Return the largest ID in the graph, or some larger number if the
+        /// largest ID is unavailable. Return value is unspecified if the graph is empty.
+        nid_t max_node_id() const;
+
+        /// Get the number of edges on the right (go_left = false) or left (go_left
+        /// = true) side of the given handle.
+        size_t get_degree(const handle_t& handle, bool go_left) const;
+
+        /// Returns true if there is an edge that allows traversal from the left
+        /// handle to the right handle.
+        bool has_edge(const handle_t& left, const handle_t& right) const;
+        using HandleGraph::has_edge;
+
+        /// Return the total number of edges in the graph.
+        size_t get_edge_count() const;
+
+    protected:
+
+        /// Loop over all the handles to next/previous (right/left) nodes. Passes
+        /// them to a callback which returns false to stop iterating and true to
+        /// continue. Returns true if we finished and false if we stopped early.
+        bool follow_edges_impl(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const;
+
+        /// Loop over all the nodes in the graph in their local forward
+        /// orientations, in ID order. Stop if the iteratee returns false.
+        /// Can be told to run in parallel, in which case stopping after a
+        /// false return value is on a best-effort basis and iteration order
+        /// is not defined. Returns true if we finished and false if we
+        /// stopped early.
+        bool for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel = false) const;
+};
+#endif /* MappedBidirectedGraph_hpp */
@@ -0,0 +1,45 @@
+#include "MemoryUsage.hpp"
+
+#include <sstream>
+using namespace std;
+
+MemoryUsage& MemoryUsage::add(const string& part_name, size_t part_bytes) {
+    parts.emplace_back(part_name, part_bytes);
+    return parts.back();
+}
+
+void MemoryUsage::add(MemoryUsage part) {
+    parts.push_back(move(part));
+}
+
+size_t MemoryUsage::total() const {
+    size_t sum = bytes;
+    for (const auto& part : parts) sum += part.total();
+    return sum;
+}
+
+void MemoryUsage::to_json(ostream& out) const {
+    out << "{\"name\": \"";
+    for (char c : name) {
+        if (c == '"' || c == '\\') out << '\\';
+        out << c;
+    }
+    out << "\", \"bytes\": " << total() << ", \"self\": " << bytes << ", \"parts\": [";
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (i > 0) out << ", ";
+        parts[i].to_json(out);
+    }
+    out << "]}";
+}
+
+string MemoryUsage::to_json() const {
+    stringstream out;
+    to_json(out);
+    return out.str();
+}
+
+size_t MemoryUsage::heap_block(size_t size) {
+    /// glibc adds an 8 byte header, rounds up to 16 and never goes below 32
+    size_t block = (size + sizeof(size_t) + 15) & ~size_t(15);
+    return block < 32 ? 32 : block;
+}
@@ -0,0 +1,62 @@
+#ifndef MemoryUsage_hpp
+#define MemoryUsage_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// Estimated heap footprint of a data structure, broken down into its parts.
+/// Sizes are computed from container capacities plus the per-element
+/// overheads of the standard library (libstdc++ node layouts, glibc malloc
+/// chunks), not measured from the allocator, so they are estimates rather
+/// than exact resident sizes.
+struct MemoryUsage {
+    std::string name;
+    /// Bytes held by this structure itself, not counting its parts
+    size_t bytes = 0;
+    std::vector<MemoryUsage> parts;
+
+    MemoryUsage(const std::string& name_, size_t bytes_ = 0) : name(name_), bytes(bytes_) {}
+
+    /// Adds a part and returns it so it can be broken down further.
+    MemoryUsage& add(const std::string& part_name, size_t part_bytes = 0);
+    void add(MemoryUsage part);
+
+    /// Bytes held by this structure and all of its parts.
+    size_t total() const;
+
+    /// Writes the report as JSON. Every entry has its name, its total
+    /// "bytes", the "self" bytes it holds directly and its "parts".
+    void to_json(std::ostream& out) const;
+    std::string to_json() const;
+
+    /// Size of the heap block malloc hands out for a request of the given size.
+    static size_t heap_block(size_t size);
+
+    template<typename T>
+    static size_t of(const std::vector<T>& v) {
+        return v.capacity() * sizeof(T);
+    }
+
+    static size_t of(const std::vector<bool>& v) {
+        return (v.capacity() + 63) / 64 * sizeof(uint64_t);
+    }
+
+    template<typename T>
+    static size_t of(const std::list<T>& l) {
+        return l.size() * heap_block(2 * sizeof(void*) + sizeof(T));
+    }
+
+    /// unordered_map and unordered_set: the bucket array plus a node (next
+    /// pointer and value) per element
+    template<typename Table>
+    static size_t of_table(const Table& table) {
+        return table.bucket_count() * sizeof(void*)
+            + table.size() * heap_block(sizeof(void*) + sizeof(typename Table::value_type));
+    }
+};
+
+#endif /* MemoryUsage_hpp */
@@ -0,0 +1,211 @@
+#include "SequenceArena.hpp"
+
+#include "handlegraph/util.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+using namespace std;
+
+static const char BASES[] = {'A', 'C', 'G', 'T'};
+
+int SequenceArena::encode(char base) {
+    switch (base) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default: return -1;
+    }
+}
+
+uint8_t SequenceArena::get_code(size_t pos) const {
+    return (words[pos / BASES_PER_WORD] >> (2 * (pos % BASES_PER_WORD))) & 3;
+}
+
+void SequenceArena::add_exception(size_t pos, size_t length, char base) {
+    while (length > 0) {
+        if (!exceptions.empty()) {
+            ExceptionRun& last = exceptions.back();
+            if (last.start + last.length == pos && last.base == base
+                    && last.length < numeric_limits<uint32_t>::max()) {
+                size_t added = min(length, size_t(numeric_limits<uint32_t>::max() - last.length));
+                last.length += added;
+                pos += added;
+                length -= added;
+                continue;
+            }
+        }
+        size_t added = min(length, size_t(numeric_limits<uint32_t>::max()));
+        exceptions.push_back({pos, static_cast<uint32_t>(added), base});
+        pos += added;
+        length -= added;
+    }
+}
+
+void SequenceArena::add_lowercase(size_t pos, size_t length) {
+    if (length == 0) return;
+    if (!lowercase.empty() && lowercase.back().start + lowercase.back().length == pos) {
+        lowercase.back().length += length;
+    } else {
+        lowercase.push_back({pos, length});
+    }
+}
+
+template<typename Run>
+typename vector<Run>::const_iterator SequenceArena::first_run(const vector<Run>& runs, size_t pos) {
+    /// The run before the first one starting after pos may still cover it
+    auto it = upper_bound(runs.begin(), runs.end(), pos,
+        [](size_t p, const Run& run) { return p < run.start; });
+    if (it != runs.begin() && prev(it)->start + prev(it)->length > pos) it--;
+    return it;
+}
+
+SequenceSpan SequenceArena::append(const string& sequence) {
+    SequenceSpan span;
+    span.offset = total;
+    span.length = sequence.size();
+    if (!keep_bases) return span;
+
+    words.resize((total + sequence.size() + BASES_PER_WORD - 1) / BASES_PER_WORD, 0);
+    for (char base : sequence) {
+        char upper = toupper(static_cast<unsigned char>(base));
+        if (upper != base) add_lowercase(total, 1);
+        int code = encode(upper);
+        if (code < 0) {
+            /// Leave the packed code as A and remember the real character
+            add_exception(total, 1, upper);
+        } else {
+            words[total / BASES_PER_WORD] |=
+                static_cast<uint64_t>(code) << (2 * (total % BASES_PER_WORD));
+        }
+        total++;
+    }
+    return span;
+}
+
+SequenceSpan SequenceArena::append(const SequenceArena& other, const SequenceSpan& span) {
+    SequenceSpan copied;
+    copied.offset = total;
+    copied.length = span.length;
+    if (!keep_bases) return copied;
+    if (!other.keep_bases) return append(string(span.length, 'N'));
+
+    words.resize((total + span.length + BASES_PER_WORD - 1) / BASES_PER_WORD, 0);
+    for (size_t i = 0; i < span.length; i++) {
+        words[total / BASES_PER_WORD] |=
+            static_cast<uint64_t>(other.get_code(span.offset + i)) << (2 * (total % BASES_PER_WORD));
+        total++;
+    }
+
+    /// Carry over the parts of runs inside the span
+    size_t end = span.offset + span.length;
+    for (auto it = first_run(other.exceptions, span.offset);
+            it != other.exceptions.end() && it->start < end; it++) {
+        size_t start = max(it->start, span.offset);
+        add_exception(copied.offset + (start - span.offset),
+            min(it->start + it->length, end) - start, it->base);
+    }
+    for (auto it = first_run(other.lowercase, span.offset);
+            it != other.lowercase.end() && it->start < end; it++) {
+        size_t start = max(it->start, span.offset);
+        add_lowercase(copied.offset + (start - span.offset), min(it->start + it->length, end) - start);
+    }
+    return copied;
+}
+
+void SequenceArena::decode(const SequenceSpan& span, bool is_reverse, string& out) const {
+    if (!keep_bases) {
+        out.assign(span.length, 'N');
+        return;
+    }
+    out.resize(span.length);
+    for (size_t i = 0; i < span.length; i++) {
+        out[i] = BASES[get_code(span.offset + i)];
+    }
+
+    /// Patch in the characters that couldn't be packed, then the case
+    size_t end = span.offset + span.length;
+    for (auto it = first_run(exceptions, span.offset); it != exceptions.end() && it->start < end; it++) {
+        size_t start = max(it->start, span.offset);
+        fill(out.begin() + (start - span.offset), out.begin() + (min(it->start + it->length, end) - span.offset),
+            it->base);
+    }
+    for (auto it = first_run(lowercase, span.offset); it != lowercase.end() && it->start < end; it++) {
+        size_t start = max(it->start, span.offset);
+        for (size_t i = start; i < min(it->start + it->length, end); i++) {
+            out[i - span.offset] = tolower(static_cast<unsigned char>(out[i - span.offset]));
+        }
+    }
+
+    if (is_reverse) handlegraph::reverse_complement_in_place(out);
+}
+
+char SequenceArena::get_base(const SequenceSpan& span, size_t index) const {
+    if (!keep_bases) return 'N';
+    size_t pos = span.offset + index;
+    auto it = first_run(exceptions, pos);
+    char base = it != exceptions.end() && it->start <= pos ? it->base : BASES[get_code(pos)];
+    auto case_it = first_run(lowercase, pos);
+    if (case_it != lowercase.end() && case_it->start <= pos) {
+        return tolower(static_cast<unsigned char>(base));
+    }
+    return base;
+}
+
+void SequenceArena::reserve(size_t bases) {
+    if (!keep_bases) return;
+    words.reserve((total + bases + BASES_PER_WORD - 1) / BASES_PER_WORD);
+}
+
+MemoryUsage SequenceArena::memory_usage() const {
+    MemoryUsage usage("arena");
+    usage.add("words", MemoryUsage::of(words));
+    usage.add("exceptions", MemoryUsage::of(exceptions));
+    usage.add("lowercase", MemoryUsage::of(lowercase));
+    return usage;
+}
+
+void SequenceArena::clear() {
+    words.clear();
+    exceptions.clear();
+    lowercase.clear();
+    total = 0;
+    unused = 0;
+}
+
+//******************************************************************************
+// Sequence views
+//******************************************************************************
+
+char SequenceView::operator[](size_t index) const {
+    if (is_reverse) {
+        return handlegraph::reverse_complement(arena->get_base(span, span.length - index - 1));
+    }
+    return arena->get_base(span, index);
+}
+
+SequenceView SequenceView::substr(size_t offset, size_t length) const {
+    offset = min(offset, span.length);
+    length = min(length, span.length - offset);
+
+    /// A reverse view counts its offset from the end of the forward span
+    SequenceSpan sub;
+    sub.offset = span.offset + (is_reverse ? span.length - offset - length : offset);
+    sub.length = length;
+    return SequenceView(*arena, sub, is_reverse);
+}
+
+void SequenceView::decode(string& out) const {
+    if (arena == nullptr) {
+        out.clear();
+        return;
+    }
+    arena->decode(span, is_reverse, out);
+}
+
+string SequenceView::str() const {
+    string out;
+    decode(out);
+    return out;
+}
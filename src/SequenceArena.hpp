@@ -0,0 +1,149 @@
+#ifndef SequenceArena_hpp
+#define SequenceArena_hpp
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MemoryUsage.hpp"
+
+/// Location of one sequence inside a SequenceArena.
+struct SequenceSpan {
+    size_t offset = 0;
+    size_t length = 0;
+};
+
+class SequenceArena;
+
+/// Read-only view of one sequence in a SequenceArena, in either orientation.
+/// Bases are decoded only when asked for, so taking a view, its size or a
+/// sub-view never allocates. A view is invalidated by any change to the graph
+/// that owns the arena.
+class SequenceView {
+    private:
+        const SequenceArena* arena = nullptr;
+        SequenceSpan span;
+        bool is_reverse = false;
+
+    public:
+        SequenceView() = default;
+        SequenceView(const SequenceArena& arena_, const SequenceSpan& span_, bool is_reverse_)
+            : arena(&arena_), span(span_), is_reverse(is_reverse_) {}
+
+        size_t size() const { return span.length; }
+        bool empty() const { return span.length == 0; }
+
+        /// Base at the given position of the view's orientation.
+        char operator[](size_t index) const;
+
+        /// View of length bases starting at offset, clipped to the end of
+        /// this view.
+        SequenceView substr(size_t offset, size_t length = std::string::npos) const;
+
+        /// Decodes the view into out, replacing its contents.
+        void decode(std::string& out) const;
+
+        /// Decodes the view into a new string.
+        std::string str() const;
+};
+
+/// Append-only store that packs many sequences into one 2-bit encoded buffer.
+/// A, C, G and T take two bits each, in either case. Lowercase is kept as a
+/// sorted list of runs, so a soft-masked stretch costs one entry. Any other
+/// character (N, IUPAC codes) is upper-cased and kept as a sorted list of runs
+/// of the same character, decoded over the packed value, so sequences
+/// round-trip exactly.
+///
+/// An arena made with keep_bases = false only records lengths. Appending to
+/// it stores nothing, and every base of its spans reads back as N.
+class SequenceArena {
+    private:
+        static const size_t BASES_PER_WORD = 32;
+
+        /// Stretch of the same character that isn't ACGT
+        struct ExceptionRun {
+            size_t start;
+            uint32_t length;
+            char base;
+        };
+
+        /// Stretch of lowercase bases
+        struct CaseRun {
+            size_t start;
+            size_t length;
+        };
+
+        /// Packed bases, 32 per word, first base in the lowest bits
+        std::vector<uint64_t> words;
+        /// Runs of bases that aren't ACGT, sorted by start
+        std::vector<ExceptionRun> exceptions;
+        /// Runs of lowercase bases, sorted by start
+        std::vector<CaseRun> lowercase;
+        /// Number of bases appended
+        size_t total = 0;
+        /// Number of bases that no longer belong to any sequence
+        size_t unused = 0;
+        /// False if only lengths are recorded
+        bool keep_bases = true;
+
+        /// Returns the 2-bit code of an upper-case ACGT base or -1 for anything else.
+        static int encode(char base);
+        /// Returns the packed code at the given position.
+        uint8_t get_code(size_t pos) const;
+        /// Records length copies of an upper-case character at pos, extending
+        /// the last run if it ends at pos with the same character.
+        void add_exception(size_t pos, size_t length, char base);
+        /// Records length lowercase bases at pos, extending the last run if it
+        /// ends at pos.
+        void add_lowercase(size_t pos, size_t length);
+        /// Returns the first run of the sorted list that ends after pos.
+        template<typename Run>
+        static typename std::vector<Run>::const_iterator first_run(const std::vector<Run>& runs, size_t pos);
+
+    public:
+        SequenceArena(bool keep_bases_ = true) : keep_bases(keep_bases_) {}
+
+        /// Packs the sequence onto the end of the arena and returns its location.
+        SequenceSpan append(const std::string& sequence);
+
+        /// Appends the span of another arena without decoding it.
+        SequenceSpan append(const SequenceArena& other, const SequenceSpan& span);
+
+        /// Decodes the span into out, replacing its contents. If is_reverse is
+        /// true the reverse complement is produced instead.
+        void decode(const SequenceSpan& span, bool is_reverse, std::string& out) const;
+
+        /// Returns the base at the given position of the span (forward strand).
+        char get_base(const SequenceSpan& span, size_t index) const;
+
+        /// Returns a view of the span, reverse complemented if is_reverse.
+        SequenceView view(const SequenceSpan& span, bool is_reverse) const {
+            return SequenceView(*this, span, is_reverse);
+        }
+
+        /// Marks a span as no longer referenced.
+        void release(const SequenceSpan& span) {
+            if (keep_bases) unused += span.length;
+        }
+
+        /// Reserves room for the given number of additional bases.
+        void reserve(size_t bases);
+
+        /// Number of bases stored, including released ones
+        size_t size() const { return total; }
+
+        /// Number of stored bases that have been released
+        size_t unused_size() const { return unused; }
+
+        /// False if the arena only records lengths
+        bool has_bases() const { return keep_bases; }
+
+        /// Heap usage of the packed bases and the exception and case runs
+        MemoryUsage memory_usage() const;
+
+        /// Removes all sequences. Whether bases are kept stays the same.
+        void clear();
+};
+
+#endif /* SequenceArena_hpp */
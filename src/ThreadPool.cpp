@@ -0,0 +1,134 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+using namespace std;
+
+/// Set while the thread is running part of a parallel loop
+static thread_local bool in_parallel_loop = false;
+
+ThreadPool::ThreadPool() {
+    thread_count = max<size_t>(thread::hardware_concurrency(), 1);
+}
+
+ThreadPool::~ThreadPool() {
+    stop_workers();
+}
+
+ThreadPool& ThreadPool::get_instance() {
+    static ThreadPool instance;
+    return instance;
+}
+
+void ThreadPool::set_thread_count(size_t count) {
+    if (count == 0) count = max<size_t>(thread::hardware_concurrency(), 1);
+
+    /// Wait for a running job to finish before resizing
+    lock_guard<mutex> job_guard(job_lock);
+    if (count == thread_count) return;
+    stop_workers();
+    thread_count = count;
+}
+
+void ThreadPool::start_workers() {
+    /// Workers start at the current generation so they pick up the next job
+    unique_lock<mutex> guard(lock);
+    size_t start_generation = generation;
+    guard.unlock();
+    while (workers.size() + 1 < thread_count) {
+        workers.emplace_back([this, start_generation]() {
+            size_t seen = start_generation;
+            while (true) {
+                unique_lock<mutex> worker_guard(lock);
+                wake.wait(worker_guard, [&]() { return shutdown || generation != seen; });
+                if (shutdown) return;
+                seen = generation;
+                worker_guard.unlock();
+
+                in_parallel_loop = true;
+                run_chunks();
+                in_parallel_loop = false;
+
+                worker_guard.lock();
+                if (--active == 0) done.notify_all();
+            }
+        });
+    }
+}
+
+void ThreadPool::stop_workers() {
+    {
+        lock_guard<mutex> guard(lock);
+        shutdown = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+    workers.clear();
+    shutdown = false;
+}
+
+void ThreadPool::run_chunks() {
+    while (true) {
+        size_t begin, end;
+        {
+            lock_guard<mutex> guard(lock);
+            if (stopped || next_index >= job_end) return;
+            begin = next_index;
+            end = min(job_end, begin + job_chunk);
+            next_index = end;
+        }
+
+        try {
+            for (size_t i = begin; i < end; i++) {
+                if (!(*job)(i)) {
+                    lock_guard<mutex> guard(lock);
+                    stopped = true;
+                    return;
+                }
+            }
+        } catch (...) {
+            lock_guard<mutex> guard(lock);
+            if (!error) error = current_exception();
+            stopped = true;
+            return;
+        }
+    }
+}
+
+bool ThreadPool::parallel_for(size_t count, const function<bool(size_t)>& iteratee) {
+    /// Small ranges, nested loops and loops racing another caller run serially
+    unique_lock<mutex> job_guard(job_lock, defer_lock);
+    if (thread_count <= 1 || count < 2 * MIN_CHUNK || in_parallel_loop || !job_guard.try_lock()) {
+        for (size_t i = 0; i < count; i++) {
+            if (!iteratee(i)) return false;
+        }
+        return true;
+    }
+
+    start_workers();
+    {
+        lock_guard<mutex> guard(lock);
+        job = &iteratee;
+        job_end = count;
+        job_chunk = max(MIN_CHUNK, count / (8 * thread_count));
+        next_index = 0;
+        stopped = false;
+        error = nullptr;
+        active = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    in_parallel_loop = true;
+    run_chunks();
+    in_parallel_loop = false;
+
+    unique_lock<mutex> guard(lock);
+    done.wait(guard, [&]() { return active == 0; });
+    job = nullptr;
+    if (error) {
+        exception_ptr thrown = error;
+        error = nullptr;
+        rethrow_exception(thrown);
+    }
+    return !stopped;
+}
@@ -0,0 +1,72 @@
+#ifndef ThreadPool_hpp
+#define ThreadPool_hpp
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Process-wide pool of worker threads used by parallel graph iteration.
+/// Workers are started lazily and stay asleep between jobs. A job splits an
+/// index range into chunks that the workers and the calling thread claim
+/// until the range is exhausted, so no ordering between indices is kept.
+class ThreadPool {
+    private:
+        /// Indices claimed at once by a thread
+        static constexpr size_t MIN_CHUNK = 256;
+
+        std::vector<std::thread> workers;
+        /// Number of threads a job runs on, including the caller
+        size_t thread_count;
+
+        /// Current job, guarded by lock
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable done;
+        const std::function<bool(size_t)>* job = nullptr;
+        size_t job_end = 0;
+        size_t job_chunk = 0;
+        size_t next_index = 0;
+        size_t generation = 0;
+        size_t active = 0;
+        bool stopped = false;
+        bool shutdown = false;
+        std::exception_ptr error;
+
+        /// Only one job runs at a time
+        std::mutex job_lock;
+
+        ThreadPool();
+        ~ThreadPool();
+
+        void start_workers();
+        void stop_workers();
+        /// Claims and runs chunks of the current job until none are left.
+        void run_chunks();
+
+    public:
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        static ThreadPool& get_instance();
+
+        /// Sets the number of threads used by parallel loops. 0 selects the
+        /// number of hardware threads.
+        void set_thread_count(size_t count);
+
+        size_t get_thread_count() const { return thread_count; }
+
+        /// Calls iteratee on every index in [0, count) using all threads, in no
+        /// particular order. If the iteratee returns false the loop stops on a
+        /// best-effort basis: indices already claimed by other threads may still
+        /// be visited. Returns true if the loop ran to completion. Exceptions
+        /// thrown by the iteratee are rethrown on the calling thread.
+        /// Loops started from inside a parallel loop, or while another thread
+        /// is running one, run serially on the calling thread.
+        bool parallel_for(size_t count, const std::function<bool(size_t)>& iteratee);
+};
+
+#endif /* ThreadPool_hpp */
@@ -1,5 +1,6 @@
 #include "bundle.hpp"
 #include <algorithm>
+#include <iterator>
 #include <handlegraph/util.hpp>
 
 using namespace std;
@@ -14,74 +15,180 @@ struct Count {
     size_t count = 0;
 };
 
+/// Order of node-sides on a bundle side: by node ID, then orientation
+inline bool handle_less(const handle_t& a, const handle_t& b) {
+    return as_integer(a) < as_integer(b);
+}
+
+size_t BundleSide::find_node(const handle_t& handle) const {
+    handle_t forward = number_bool_packing::pack(number_bool_packing::unpack_number(handle), false);
+    auto it = lower_bound(nodes.begin(), nodes.end(), forward, handle_less);
+    if (it == nodes.end() || number_bool_packing::unpack_number(*it) != number_bool_packing::unpack_number(handle)) {
+        return nodes.size();
+    }
+    return it - nodes.begin();
+}
+
 bool BundleSide::add_node(const handle_t& handle) {
-    return nodes.insert(handle).second;
+    auto it = lower_bound(nodes.begin(), nodes.end(), handle, handle_less);
+    if (it != nodes.end() && *it == handle) return false;
+    nodes.insert(it, handle);
+    return true;
+}
+
+void BundleSide::assign(const vector<handle_t>& handles) {
+    nodes.assign(handles.begin(), handles.end());
+    sort(nodes.begin(), nodes.end(), handle_less);
+}
+
+bool BundleSide::contains(const handle_t& handle) const {
+    return binary_search(nodes.begin(), nodes.end(), handle, handle_less);
 }
 
-void BundleSide::update(const HandleGraph& g) {
-    nodes_flipped.clear();
-    for (auto& node : nodes) {
-        nodes_flipped.insert(g.flip(node));
+bool BundleSide::remove_node(const handle_t& handle) {
+    auto it = lower_bound(nodes.begin(), nodes.end(), handle, handle_less);
+    if (it == nodes.end() || *it != handle) return false;
+    nodes.erase(it);
+    return true;
+}
+
+void BundleSide::merge(const BundleSide& other, bool is_reversed) {
+    /// Only a flipped side needs a copy, to put it back in order
+    BundleSide flipped;
+    if (is_reversed) {
+        flipped = other;
+        flipped.flip_nodes();
+    }
+    const vector<handle_t>& added = is_reversed ? flipped.nodes : other.nodes;
+    vector<handle_t> merged;
+    merged.reserve(nodes.size() + added.size());
+    set_union(nodes.begin(), nodes.end(), added.begin(), added.end(),
+            back_inserter(merged), handle_less);
+    nodes.swap(merged);
+}
+
+void BundleSide::erase(const BundleSide& other) {
+    /// Both sides are sorted, so one pass drops the shared entries
+    auto removed = other.nodes.begin();
+    auto kept = remove_if(nodes.begin(), nodes.end(), [&](const handle_t& handle) {
+        while (removed != other.nodes.end() && handle_less(*removed, handle)) removed++;
+        return removed != other.nodes.end() && *removed == handle;
+    });
+    nodes.erase(kept, nodes.end());
+}
+
+void BundleSide::flip_nodes() {
+    /// Flipping only reorders the two orientations of a node, which are
+    /// neighbours, so swapping those pairs restores the order
+    for (auto& handle : nodes) handle = number_bool_packing::toggle_bit(handle);
+    for (size_t i = 0; i + 1 < nodes.size(); i++) {
+        if (handle_less(nodes[i + 1], nodes[i])) {
+            swap(nodes[i], nodes[i + 1]);
+            i++;
+        }
     }
 }
 
 void BundleSide::reset() {
     nodes.clear();
-    nodes_flipped.clear();
+}
+
+bool BundleSide::find(const handle_t& handle, bool& is_reversed) const {
+    size_t i = find_node(handle);
+    if (i == nodes.size()) return false;
+    /// The node's entries are its forward orientation, its reverse, or both
+    handle_t flipped = number_bool_packing::toggle_bit(handle);
+    is_reversed = nodes[i] == flipped || (i + 1 < nodes.size() && nodes[i + 1] == flipped);
+    return true;
 }
 
 bool BundleSide::is_reversed(const handle_t& handle) const  {
-    return nodes_flipped.find(handle) != nodes_flipped.end();
+    bool reversed;
+    return find(handle, reversed) && reversed;
 }
 
 bool BundleSide::is_member(const handle_t& handle) const {
-    return nodes.find(handle) != nodes.end() ||
-        nodes_flipped.find(handle) != nodes_flipped.end();
+    return find_node(handle) != nodes.size();
 }
 
-bool BundleSide::iterate_nodes(const function<bool(const handle_t&)>& iteratee, bool is_reversed) const {
-    if (is_reversed) {
-        for (auto& handle : nodes_flipped) {
-            if (!iteratee(handle)) {
-                return false;
-            }
+bool BundleSide::shares_node(const BundleSide& other) const {
+    /// Both sides are sorted by node ID, so one merge pass finds any overlap
+    auto a = nodes.begin();
+    auto b = other.nodes.begin();
+    while (a != nodes.end() && b != other.nodes.end()) {
+        nid_t a_id = number_bool_packing::unpack_number(*a);
+        nid_t b_id = number_bool_packing::unpack_number(*b);
+        if (a_id == b_id) return true;
+        if (a_id < b_id) {
+            a++;
+        } else {
+            b++;
         }
-    } else {
-        for (auto& handle : nodes) {
-            if (!iteratee(handle)) {
-                return false;
-            }
+    }
+    return false;
+}
+
+bool BundleSide::iterate_nodes(const function<bool(const handle_t&)>& iteratee, bool is_reversed) const {
+    for (const auto& handle : nodes) {
+        if (!iteratee(is_reversed ? number_bool_packing::toggle_bit(handle) : handle)) {
+            return false;
         }
     }
     return true;
 }
 
-void Bundle::update_bundlesides(const HandleGraph& g) {
-    left.update(g);
-    right.update(g);
+MemoryUsage BundleSide::memory_usage(const string& name) const {
+    MemoryUsage usage(name);
+    usage.add("nodes", MemoryUsage::of(nodes));
+    return usage;
 }
 
-void Bundle::define_properties(const HandleGraph& g) {
-    update_bundlesides(g);
-
+void Bundle::define_properties() {
     is_bundle_trivial = left.size() == 1 && right.size() == 1;
+    is_bundle_cyclic = left.shares_node(right);
+}
 
-    is_bundle_cyclic = false;
-    for (const auto& left_handle : left) {
-        is_bundle_cyclic |= right.is_member(left_handle);
-    }
+void Bundle::mirror() {
+    swap(left, right);
+    left.flip_nodes();
+    right.flip_nodes();
 }
 
 bool Bundle::traverse_bundle(const handle_t& handle, const function<bool(const handle_t&)>& iteratee) const {
-    if (left.is_member(handle)) {
-        return right.iterate_nodes(iteratee, left.is_reversed(handle));
-    } else if (right.is_member(handle)) {
-        return left.iterate_nodes(iteratee, right.is_reversed(handle));
+    bool reversed;
+    if (left.find(handle, reversed)) {
+        return right.iterate_nodes(iteratee, reversed);
+    } else if (right.find(handle, reversed)) {
+        return left.iterate_nodes(iteratee, reversed);
     }
+    /// Handles outside the bundle have nothing to traverse
+    return true;
 }
 
 bool Bundle::is_reversed(const handle_t& handle) const {
-    return (left.is_member(handle) && left.is_reversed(handle)) ||
-        (right.is_member(handle) && !right.is_reversed(handle));
+    bool reversed;
+    if (left.find(handle, reversed)) {
+        return reversed || (right.find(handle, reversed) && !reversed);
+    }
+    return right.find(handle, reversed) && !reversed;
 }
 
+MemoryUsage Bundle::memory_usage() const {
+    MemoryUsage usage("Bundle", sizeof(Bundle));
+    usage.add(left.memory_usage("left"));
+    usage.add(right.memory_usage("right"));
+    return usage;
+}
+
+MemoryUsage BundlePool::memory_usage() const {
+    MemoryUsage usage("BundlePool", sizeof(BundlePool));
+    usage.add("bundles", MemoryUsage::of(bundles));
+
+    /// Pools hold many bundles, so they're summed rather than listed
+    size_t idle = 0;
+    for (const Bundle* bundle : bundles) {
+        idle += MemoryUsage::heap_block(sizeof(Bundle)) + bundle->memory_usage().total() - sizeof(Bundle);
+    }
+    usage.add("idle_bundles", idle);
+    return usage;
+}
@@ -1,16 +1,25 @@
 #ifndef VG_ALGORITHMS_BUNDLE_HPP_INCLUDED
 #define VG_ALGORITHMS_BUNDLE_HPP_INCLUDED
 
-#include <unordered_set>
 #include <list>
+#include <mutex>
+#include <vector>
 
 #include "handle.hpp"
+#include "../MemoryUsage.hpp"
 
-/// Glorified wrapper for std::unordered_set<handle_t>
+/// One side of a bundle, held as a flat array of node-sides sorted by their
+/// packed value: node ID first, then the orientation bit. Both orientations
+/// of a node are therefore adjacent, and membership and orientation are
+/// answered by one binary search. Every graph here packs handles that way.
 class BundleSide {
     private:
-        std::unordered_set<handle_t> nodes;
-        std::unordered_set<handle_t> nodes_flipped;
+        std::vector<handle_t> nodes;
+
+        /// Returns the position of the first entry for the handle's node, or
+        /// nodes.size() if neither orientation is on this side.
+        size_t find_node(const handle_t& handle) const;
+
     public:
         /// Returns true if successful addition, false if otherwise
         bool add_node(const handle_t& handle);
@@ -19,33 +28,66 @@ class BundleSide {
             add_node(handle);
         }
 
+        /// Replaces the side with the given distinct node-sides, sorting them
+        /// once instead of inserting them one by one.
+        void assign(const std::vector<handle_t>& handles);
+
+        /// Returns true if the node-side itself (not only its node) is here
+        bool contains(const handle_t& handle) const;
+
+        /// Returns true if the node-side was here and has been removed
+        bool remove_node(const handle_t& handle);
+
+        /// Adds every node-side of the other side, flipped if is_reversed,
+        /// in one merge pass. Node-sides already here are kept once. Only a
+        /// flipped side is copied first.
+        void merge(const BundleSide& other, bool is_reversed);
+
+        /// Removes every node-side that is on the other side
+        void erase(const BundleSide& other);
+
+        /// Flips every node-side, keeping the side sorted
+        void flip_nodes();
+
         size_t size() const { return nodes.size(); }
         
-        std::unordered_set<handle_t>::iterator begin() {
+        std::vector<handle_t>::const_iterator begin() const {
             return nodes.begin();
         }
 
-        std::unordered_set<handle_t>::iterator end() {
+        std::vector<handle_t>::const_iterator end() const {
             return nodes.end();
         }
 
-        std::unordered_set<handle_t>::const_iterator cbegin() const {
+        std::vector<handle_t>::const_iterator cbegin() const {
             return nodes.cbegin();
         }
 
-        std::unordered_set<handle_t>::const_iterator cend() const {
+        std::vector<handle_t>::const_iterator cend() const {
             return nodes.cend();
         }
 
-        void update(const HandleGraph& g);
-
         void reset();
         
+        /// Returns true if the handle's node is on this side in the other
+        /// orientation
         bool is_reversed(const handle_t& handle) const;
 
+        /// Returns true if the handle's node is on this side in either
+        /// orientation
         bool is_member(const handle_t& handle) const;
 
+        /// Looks the handle's node up once. Returns is_member(handle) and
+        /// sets is_reversed as is_reversed(handle) would if it's a member.
+        bool find(const handle_t& handle, bool& is_reversed) const;
+
+        /// Returns true if some node is on both this side and the other.
+        bool shares_node(const BundleSide& other) const;
+
         bool iterate_nodes(const std::function<bool(const handle_t&)>& iteratee, bool is_reversed) const;
+
+        /// Heap held by the node array (the object itself is counted by its bundle)
+        MemoryUsage memory_usage(const std::string& name) const;
 };
 
 /// Glorified wrapper for std::pair<BundleSide, BundleSide>
@@ -53,11 +95,9 @@ class Bundle {
     private:
         BundleSide left;
         BundleSide right;
-        bool is_bundle_balanced; /// Is a balanced bundle
-        bool is_bundle_trivial; /// Is a trivial bundle
-        bool is_bundle_cyclic; /// Has self-cycle or self-inversion
-
-        void update_bundlesides(const HandleGraph& g);
+        bool is_bundle_balanced = false; /// Is a balanced bundle
+        bool is_bundle_trivial = false; /// Is a trivial bundle
+        bool is_bundle_cyclic = false; /// Has self-cycle or self-inversion
 
     public:
         BundleSide& get_bundleside(bool is_left) {
@@ -79,6 +119,18 @@ class Bundle {
         bool is_trivial() const { return is_bundle_trivial; }
         bool is_cyclic() const { return is_bundle_cyclic; }
 
+        /// Sets the properties of a bundle that has been edited in place.
+        /// is_trivial is read off the sizes of the sides.
+        void set_properties(bool is_balanced_, bool is_cyclic_) {
+            is_bundle_balanced = is_balanced_;
+            is_bundle_trivial = left.size() == 1 && right.size() == 1;
+            is_bundle_cyclic = is_cyclic_;
+        }
+
+        /// Swaps the sides and flips every node-side: the same bundle seen
+        /// from the node-sides of its other side.
+        void mirror();
+
         void reset() {
             is_bundle_balanced = false;
             is_bundle_trivial = false;
@@ -89,18 +141,23 @@ class Bundle {
 
         /// Checks properties of a bundle
         /// Properties: is_trivial, is_cyclic (has self-cycle or inversion)
-        void define_properties(const HandleGraph& g);
+        void define_properties();
 
         bool traverse_bundle(const handle_t& handle, const std::function<bool(const handle_t&)>& iteratee) const;
 
         /// Returns if go_left is false if calling follow_edges will traverse the bundle or not
         bool is_reversed(const handle_t& handle) const;
+
+        /// Size of the bundle object plus the heap held by its bundle sides
+        MemoryUsage memory_usage() const;
 };
 
-/// Bundle pool object
+/// Bundle pool object. Bundles may be taken and returned from several
+/// threads at once; get_instance() must have been called once beforehand.
 class BundlePool {
     private:
         std::list<Bundle *> bundles;
+        std::mutex bundles_lock;
 
         static BundlePool *instance;
         BundlePool() {}
@@ -114,6 +171,7 @@ class BundlePool {
         }
 
         Bundle* get_bundle() {
+            std::lock_guard<std::mutex> guard(bundles_lock);
             if (bundles.empty()) {
                 return new Bundle;
             } else {
@@ -125,6 +183,7 @@ class BundlePool {
 
         void return_bundle(Bundle* bundle) {
             bundle->reset();
+            std::lock_guard<std::mutex> guard(bundles_lock);
             bundles.push_back(bundle);
         }
 
@@ -135,6 +194,9 @@ class BundlePool {
             delete instance;
             instance = nullptr;
         }
+
+        /// Heap held by the pool and the idle bundles waiting in it
+        MemoryUsage memory_usage() const;
 };
 
 #endif /* VG_ALGORITHMS_BUNDLE_HPP_INCLUDED */
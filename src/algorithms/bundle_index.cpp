@@ -0,0 +1,521 @@
+#include "bundle_index.hpp"
+#include "find_bundles.hpp"
+#include <utility>
+
+using namespace handlegraph;
+using namespace std;
+
+/** Node-sides of a bundle
+ * The node-sides mapped to a bundle are its left node-sides and its flipped
+ * right node-sides, i.e. exactly the node-sides with edges on their right.
+ * An edge from a to b joins node-sides a and flip(b). Going right from a
+ * node-side on the left reaches the right side, and going right from a
+ * flipped right node-side reaches the flipped left side, so the two ends of
+ * an edge are on opposite sides. A bundle is then one connected group of
+ * node-sides, split in two so that every edge joins the two halves. A
+ * self-inversion joins a node-side to itself; such a group can't be split in
+ * two and every node-side of it is on both sides.
+ */
+
+//******************************************************************************
+// Public functions
+//******************************************************************************
+
+BundleIndex::~BundleIndex() {
+    clear();
+}
+
+void BundleIndex::build(bool parallel) {
+    clear();
+    for (auto& bundle : find_bundles(*g, false, parallel)) mark(bundle);
+}
+
+void BundleIndex::clear() {
+    /// Every bundle is in degree_sums once
+    for (auto& entry : degree_sums) {
+        BundlePool::get_instance()->return_bundle(const_cast<Bundle*>(entry.first));
+    }
+    degree_sums.clear();
+    for (auto& entry : changes) {
+        if (entry.second.is_taken) released.push_back(entry.first);
+    }
+    changes.clear();
+    bundle_map.clear();
+}
+
+Bundle* BundleIndex::find(const handle_t& handle) const {
+    auto it = bundle_map.find(handle);
+    return it == bundle_map.end() ? nullptr : it->second;
+}
+
+Bundle* BundleIndex::orient(const handle_t& handle) {
+    Bundle* bundle = find(handle);
+    if (bundle != nullptr && !bundle->get_left().contains(handle)) bundle->mirror();
+    return bundle;
+}
+
+void BundleIndex::create_edge(const handle_t& left, const handle_t& right) {
+    if (g->has_edge(left, right)) return;
+    g->create_edge(left, right);
+    add_edge(left, right);
+    note_ends(left, right);
+}
+
+void BundleIndex::destroy_edge(const handle_t& left, const handle_t& right) {
+    if (!g->has_edge(left, right)) return;
+    g->destroy_edge(left, right);
+    remove_edge(left, right);
+    note_ends(left, right);
+}
+
+size_t BundleIndex::get_serial(const Bundle* bundle) const {
+    auto it = changes.find(bundle);
+    return it == changes.end() ? 0 : it->second.serial;
+}
+
+unordered_set<handle_t> BundleIndex::take_changes(const Bundle* bundle) {
+    unordered_set<handle_t> keys;
+    auto it = changes.find(bundle);
+    if (it != changes.end()) {
+        swap(keys, it->second.keys);
+        it->second.is_taken = true;
+    }
+    return keys;
+}
+
+vector<const Bundle*> BundleIndex::take_released() {
+    vector<const Bundle*> bundles;
+    swap(bundles, released);
+    return bundles;
+}
+
+void BundleIndex::destroy_handle(const handle_t& handle) {
+    /// Edges are listed first so removing them doesn't disturb the walk
+    vector<pair<handle_t, handle_t>> edges;
+    for (bool is_reverse : {false, true}) {
+        handle_t side = g->get_handle(g->get_id(handle), is_reverse);
+        g->follow_edges(side, false, [&](const handle_t& next) {
+            edges.emplace_back(side, next);
+        });
+    }
+    for (const auto& edge : edges) destroy_edge(edge.first, edge.second);
+    g->destroy_handle(handle);
+}
+
+MemoryUsage BundleIndex::memory_usage() const {
+    MemoryUsage usage("BundleIndex", sizeof(BundleIndex));
+    usage.add("bundle_map", MemoryUsage::of_table(bundle_map));
+    usage.add("degree_sums", MemoryUsage::of_table(degree_sums));
+    usage.add("changes", MemoryUsage::of_table(changes));
+    usage.add("released", MemoryUsage::of(released));
+    size_t bundle_bytes = 0;
+    for (const auto& entry : degree_sums) {
+        bundle_bytes += MemoryUsage::heap_block(sizeof(Bundle))
+            + entry.first->memory_usage().total() - sizeof(Bundle);
+    }
+    usage.add("bundles", bundle_bytes);
+    return usage;
+}
+
+//******************************************************************************
+// Private functions
+//******************************************************************************
+
+void BundleIndex::mark(Bundle* bundle) {
+    renew(bundle);
+    size_t& degree_sum = degree_sums[bundle];
+    degree_sum = 0;
+    for (auto& handle : bundle->get_left()) {
+        bundle_map[handle] = bundle;
+        degree_sum += g->get_degree(handle, false);
+    }
+    for (auto& handle : bundle->get_right()) {
+        handle_t key = g->flip(handle);
+        if (bundle->get_left().contains(key)) continue;
+        bundle_map[key] = bundle;
+        degree_sum += g->get_degree(key, false);
+    }
+}
+
+void BundleIndex::unmark(Bundle* bundle) {
+    for (auto& handle : bundle->get_left()) bundle_map.erase(handle);
+    for (auto& handle : bundle->get_right()) bundle_map.erase(g->flip(handle));
+    release(bundle);
+}
+
+void BundleIndex::release(Bundle* bundle) {
+    degree_sums.erase(bundle);
+    auto it = changes.find(bundle);
+    if (it != changes.end()) {
+        if (it->second.is_taken) released.push_back(bundle);
+        changes.erase(it);
+    }
+    BundlePool::get_instance()->return_bundle(bundle);
+}
+
+void BundleIndex::renew(Bundle* bundle) {
+    changes[bundle] = Changes{++serial, {}};
+}
+
+void BundleIndex::note(const handle_t& key) {
+    Bundle* bundle = find(key);
+    if (bundle != nullptr) changes[bundle].keys.insert(key);
+}
+
+void BundleIndex::note_ends(const handle_t& left, const handle_t& right) {
+    /// The ends joined to or left in the bundle of the edge, and the
+    /// node-sides that have the ends as outer neighbors
+    for (const handle_t& key : {left, g->flip(right), g->flip(left), right}) note(key);
+}
+
+bool BundleIndex::is_mirrored(Bundle* bundle, const handle_t& key) const {
+    return bundle->get_left().contains(key) && bundle->get_right().contains(g->flip(key));
+}
+
+void BundleIndex::close_mirror(Bundle* bundle) {
+    bundle->get_left().merge(bundle->get_right(), true);
+    bundle->get_right().merge(bundle->get_left(), true);
+}
+
+void BundleIndex::set_properties(Bundle* bundle, bool is_cyclic) {
+    /// Each edge between the sides adds one to the degrees of both of its
+    /// ends, unless every node-side is on both sides
+    size_t edges = degree_sums[bundle];
+    if (bundle->get_left().size() && !is_mirrored(bundle, *bundle->get_left().begin())) edges /= 2;
+    bundle->set_properties(edges == bundle->get_left().size() * bundle->get_right().size(), is_cyclic);
+}
+
+Bundle* BundleIndex::get_or_start(const handle_t& key) {
+    Bundle* bundle = find(key);
+    if (bundle != nullptr) return bundle;
+    bundle = BundlePool::get_instance()->get_bundle();
+    bundle->get_left().add_node(key);
+    bundle_map[key] = bundle;
+    degree_sums[bundle] = 0;
+    renew(bundle);
+    return bundle;
+}
+
+Bundle* BundleIndex::merge(Bundle* a, handle_t key_a, Bundle* b, handle_t key_b) {
+    if (a->get_left().size() + a->get_right().size() < b->get_left().size() + b->get_right().size()) {
+        swap(a, b);
+        swap(key_a, key_b);
+    }
+    bool is_a_mirrored = is_mirrored(a, key_a);
+    bool is_b_mirrored = is_mirrored(b, key_b);
+
+    /// The ends of the new edge must end up on opposite sides
+    bool is_aligned = a->get_left().contains(key_a) ? b->get_right().contains(g->flip(key_b))
+        : b->get_left().contains(key_b);
+    if (!is_aligned) b->mirror();
+
+    bool is_cyclic = a->is_cyclic() || b->is_cyclic();
+    unordered_set<handle_t>& moved = changes[a].keys;
+    for (auto& handle : b->get_left()) {
+        is_cyclic = is_cyclic || a->get_right().is_member(handle);
+        bundle_map[handle] = a;
+        moved.insert(handle);
+    }
+    for (auto& handle : b->get_right()) {
+        is_cyclic = is_cyclic || a->get_left().is_member(handle);
+        bundle_map[g->flip(handle)] = a;
+        moved.insert(g->flip(handle));
+    }
+    a->get_left().merge(b->get_left(), false);
+    a->get_right().merge(b->get_right(), false);
+    /// Every node-side of a mirrored bundle is on both sides, so only the
+    /// node-sides moved in need their mirror images
+    if (is_a_mirrored) {
+        a->get_left().merge(b->get_right(), true);
+        a->get_right().merge(b->get_left(), true);
+        is_cyclic = true;
+    }
+    degree_sums[a] += degree_sums[b];
+    release(b);
+
+    if (!is_a_mirrored && is_b_mirrored) {
+        close_mirror(a);
+        is_cyclic = true;
+    }
+    set_properties(a, is_cyclic);
+    return a;
+}
+
+void BundleIndex::add_edge(const handle_t& left, const handle_t& right) {
+    handle_t key = left;
+    handle_t other = g->flip(right);
+    Bundle* bundle = get_or_start(key);
+    Bundle* other_bundle = get_or_start(other);
+    if (bundle != other_bundle) bundle = merge(bundle, key, other_bundle, other);
+
+    bool was_mirrored = is_mirrored(bundle, key);
+    bool is_cyclic = bundle->is_cyclic();
+    if (bundle->get_left().contains(key) && bundle->get_right().add_node(right)) {
+        is_cyclic = is_cyclic || bundle->get_left().is_member(right);
+    }
+    if (bundle->get_right().contains(g->flip(key)) && bundle->get_left().add_node(other)) {
+        is_cyclic = is_cyclic || bundle->get_right().is_member(other);
+    }
+    degree_sums[bundle] += (key == other) ? 1 : 2;
+
+    /// The edge closed a cycle of odd length, e.g. a self-inversion
+    if (!was_mirrored && is_mirrored(bundle, other)) {
+        close_mirror(bundle);
+        is_cyclic = true;
+    }
+    set_properties(bundle, is_cyclic);
+}
+
+void BundleIndex::remove_edge(const handle_t& left, const handle_t& right) {
+    handle_t key = left;
+    handle_t other = g->flip(right);
+    Bundle* bundle = find(key);
+    if (bundle == nullptr) return;
+    degree_sums[bundle] -= (key == other) ? 1 : 2;
+    if (is_mirrored(bundle, key)) {
+        settle_mirror(bundle, key, other);
+        return;
+    }
+
+    /// Node-sides without edges left leave the bundle. The others are all
+    /// still joined to one of the two ends.
+    bool was_cyclic = bundle->is_cyclic();
+    size_t kept = 0;
+    for (const handle_t& end : {key, other}) {
+        if (g->get_degree(end, false)) {
+            kept++;
+            continue;
+        }
+        bundle->get_left().remove_node(end);
+        bundle->get_right().remove_node(g->flip(end));
+        bundle_map.erase(end);
+    }
+    if (bundle->get_left().size() == 0 && bundle->get_right().size() == 0) {
+        release(bundle);
+        return;
+    }
+
+    vector<handle_t> part;
+    if (kept == 2 && separate(key, other, part)) split(bundle, part);
+    set_properties(bundle, was_cyclic && bundle->get_left().shares_node(bundle->get_right()));
+}
+
+bool BundleIndex::is_close(const handle_t& key_a, const handle_t& key_b) const {
+    /// Probe from the end with fewer edges, for no more edges than
+    /// following both ends would take
+    handle_t near = key_a;
+    handle_t far = key_b;
+    if (g->get_degree(far, false) < g->get_degree(near, false)) swap(near, far);
+    size_t budget = g->get_degree(near, false) + g->get_degree(far, false);
+    bool is_found = false;
+    g->follow_edges(near, false, [&](const handle_t& next) {
+        handle_t middle = g->flip(next);
+        return g->follow_edges(far, false, [&](const handle_t& last) {
+            is_found = g->has_edge(middle, last);
+            return !is_found && --budget > 0;
+        });
+    });
+    return is_found;
+}
+
+bool BundleIndex::separate(const handle_t& key_a, const handle_t& key_b, vector<handle_t>& part) {
+    if (is_close(key_a, key_b)) return false;
+
+    /// Node-sides found so far and the search that found them
+    unordered_map<handle_t, size_t> found;
+    vector<handle_t> queues[2] = {{key_a}, {key_b}};
+    size_t next[2] = {0, 0};
+    /// Edges followed so far by each search
+    size_t work[2] = {0, 0};
+    found.emplace(key_a, 0);
+    found.emplace(key_b, 1);
+
+    /// The search that would have followed fewer edges goes next, so a
+    /// node-side with many edges is only followed once the other search
+    /// has done as much work
+    while (true) {
+        for (size_t i = 0; i < 2; i++) {
+            if (next[i] == queues[i].size()) {
+                part.swap(queues[i]);
+                return true;
+            }
+        }
+        size_t costs[2];
+        for (size_t i = 0; i < 2; i++) {
+            costs[i] = work[i] + g->get_degree(queues[i][next[i]], false);
+        }
+        size_t i = costs[1] < costs[0] ? 1 : 0;
+        handle_t handle = queues[i][next[i]++];
+        work[i] = costs[i];
+        bool is_apart = g->follow_edges(handle, false, [&](const handle_t& neighbor) {
+            auto [it, is_new] = found.emplace(g->flip(neighbor), i);
+            if (is_new) queues[i].push_back(it->first);
+            return is_new || it->second == i;
+        });
+        if (!is_apart) return false;
+    }
+}
+
+void BundleIndex::split(Bundle* bundle, const vector<handle_t>& part) {
+    Bundle* new_bundle = BundlePool::get_instance()->get_bundle();
+    renew(new_bundle);
+    vector<handle_t> left;
+    vector<handle_t> right;
+    size_t degree_sum = 0;
+    for (const auto& key : part) {
+        if (bundle->get_left().contains(key)) {
+            left.push_back(key);
+        } else {
+            right.push_back(g->flip(key));
+        }
+        bundle_map[key] = new_bundle;
+        degree_sum += g->get_degree(key, false);
+    }
+    new_bundle->get_left().assign(left);
+    new_bundle->get_right().assign(right);
+    bundle->get_left().erase(new_bundle->get_left());
+    bundle->get_right().erase(new_bundle->get_right());
+
+    degree_sums[new_bundle] = degree_sum;
+    degree_sums[bundle] -= degree_sum;
+    set_properties(new_bundle, bundle->is_cyclic()
+            && new_bundle->get_left().shares_node(new_bundle->get_right()));
+}
+
+void BundleIndex::settle_mirror(Bundle* bundle, const handle_t& key_a, const handle_t& key_b) {
+    /// Ends without edges left leave both sides. The others are searched
+    /// from, and everything else left is joined to one of them.
+    vector<handle_t> roots;
+    for (const handle_t& end : {key_a, key_b}) {
+        if (g->get_degree(end, false)) {
+            if (roots.empty() || roots.front() != end) roots.push_back(end);
+        } else if (bundle_map.erase(end)) {
+            bundle->get_left().remove_node(end);
+            bundle->get_right().remove_node(g->flip(end));
+        }
+    }
+    if (roots.empty()) {
+        release(bundle);
+        return;
+    }
+
+    /// Node-sides found so far, the search that found them and the side
+    /// they would take if the bundle had two. Once the searches meet,
+    /// sides found by the second are read flipped if offset is set.
+    struct Found {
+        size_t search;
+        bool side;
+    };
+    unordered_map<handle_t, Found> found;
+    vector<handle_t> queues[2];
+    size_t next[2] = {0, 0};
+    size_t work[2] = {0, 0};
+    /// Whether each search has found a cycle of odd length, which keeps
+    /// the node-sides it reaches on both sides
+    bool is_odd[2] = {false, false};
+    bool is_met = roots.size() == 1;
+    bool offset = false;
+    for (size_t i = 0; i < roots.size(); i++) {
+        queues[i].push_back(roots[i]);
+        found.emplace(roots[i], Found{i, false});
+    }
+    auto side_of = [&](const Found& entry) {
+        return entry.side != (entry.search == 1 && offset);
+    };
+    auto step = [&](size_t i) {
+        handle_t handle = queues[i][next[i]++];
+        work[i] += g->get_degree(handle, false);
+        Found entry = found.at(handle);
+        g->follow_edges(handle, false, [&](const handle_t& neighbor) {
+            auto [it, is_new] = found.emplace(g->flip(neighbor), Found{i, !entry.side});
+            if (is_new) {
+                queues[i].push_back(it->first);
+            } else if (is_met || it->second.search == i) {
+                is_odd[i] = is_odd[i] || side_of(it->second) == side_of(entry);
+            } else {
+                /// The searches meet. Line their sides up along this edge.
+                is_met = true;
+                offset = it->second.side == entry.side;
+            }
+        });
+    };
+    auto is_left = [&](size_t i) {
+        return next[i] < queues[i].size();
+    };
+
+    /// Search from both ends, the cheaper one first, until they meet or
+    /// one runs out. The node-sides of one that runs out split off.
+    size_t part = 2;
+    while (!is_met) {
+        if (!is_left(0) || !is_left(1)) {
+            part = is_left(0) ? 1 : 0;
+            break;
+        }
+        size_t costs[2];
+        for (size_t i = 0; i < 2; i++) {
+            costs[i] = work[i] + g->get_degree(queues[i][next[i]], false);
+        }
+        step(costs[1] < costs[0] ? 1 : 0);
+    }
+    if (part != 2) {
+        Bundle* new_bundle = BundlePool::get_instance()->get_bundle();
+        renew(new_bundle);
+        vector<handle_t> sides[2];
+        vector<handle_t> moved[2];
+        size_t degree_sum = 0;
+        for (const auto& key : queues[part]) {
+            moved[0].push_back(key);
+            moved[1].push_back(g->flip(key));
+            bundle_map[key] = new_bundle;
+            degree_sum += g->get_degree(key, false);
+            if (is_odd[part] || !found.at(key).side) sides[0].push_back(key);
+            if (is_odd[part] || found.at(key).side) sides[1].push_back(g->flip(key));
+        }
+        /// The bundle had every node-side on both sides, so they all leave both
+        BundleSide removed;
+        for (size_t i = 0; i < 2; i++) {
+            removed.assign(moved[i]);
+            bundle->get_bundleside(i == 0).erase(removed);
+        }
+        new_bundle->get_left().assign(sides[0]);
+        new_bundle->get_right().assign(sides[1]);
+        degree_sums[new_bundle] = degree_sum;
+        degree_sums[bundle] -= degree_sum;
+        set_properties(new_bundle, is_odd[part] || new_bundle->get_left().shares_node(new_bundle->get_right()));
+    }
+
+    /// What is left stays on both sides once a cycle of odd length is found
+    /// in it. If there is none it has been searched whole, and goes back to
+    /// two sides.
+    size_t first = part == 0 ? 1 : 0;
+    size_t last = part == 2 ? roots.size() : first + 1;
+    auto is_mirror_left = [&]() {
+        for (size_t i = first; i < last; i++) {
+            if (is_odd[i]) return true;
+        }
+        return false;
+    };
+    while (!is_mirror_left()) {
+        size_t i = first;
+        while (i < last && !is_left(i)) i++;
+        if (i == last) break;
+        step(i);
+    }
+    if (is_mirror_left()) {
+        set_properties(bundle, true);
+        return;
+    }
+    vector<handle_t> sides[2];
+    for (size_t i = first; i < last; i++) {
+        for (const auto& key : queues[i]) {
+            if (side_of(found.at(key))) {
+                sides[1].push_back(g->flip(key));
+            } else {
+                sides[0].push_back(key);
+            }
+        }
+    }
+    bundle->get_left().assign(sides[0]);
+    bundle->get_right().assign(sides[1]);
+    set_properties(bundle, bundle->get_left().shares_node(bundle->get_right()));
+}
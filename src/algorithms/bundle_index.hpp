@@ -0,0 +1,172 @@
+#ifndef VG_ALGORITHMS_BUNDLE_INDEX_HPP_INCLUDED
+#define VG_ALGORITHMS_BUNDLE_INDEX_HPP_INCLUDED
+
+/**
+ * \file bundle_index.hpp
+ *
+ * Bundles of a graph that is being edited, kept up to date one edit at a
+ * time instead of being found again after every change.
+ */
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "handle.hpp"
+#include "bundle.hpp"
+#include "../MemoryUsage.hpp"
+
+/// Maps node-side to the bundle it belongs to
+using bundle_map_t = std::unordered_map<handle_t, Bundle*>;
+
+/// The (unbalanced) bundles of a graph that is edited through this index.
+/// Every node-side with edges on its go_left = false side maps to its
+/// bundle: left node-sides as they are, right node-sides flipped. That is
+/// the mapping DecompositionTreeBuilder used to rebuild with find_bundle
+/// after every reduction.
+///
+/// An edit only looks at the bundle, or two bundles, at the ends of the
+/// edge:
+/// - A new edge adds its ends to their bundle. If the ends were in two
+///   bundles, the smaller one is moved into the larger.
+/// - A removed edge drops ends that have no edges left. If both ends stay
+///   and no path of three edges joins them, the bundle is searched from
+///   both at once until the searches meet. If one search runs out first,
+///   the node-sides it found split off.
+/// - A destroyed node has its edges removed one at a time.
+/// Bundles that hold a self-inversion, or any other cycle of odd length,
+/// have every node-side on both sides. When one of their edges goes, the
+/// searches from its ends also give each node-side they find a side, and
+/// stop once they have met and found a cycle of odd length, which leaves
+/// the bundle as it was. A part that is left without such a cycle has been
+/// searched whole and goes back to two sides.
+///
+/// An edit follows no node-side of a bundle other than the ones it moves
+/// between bundles or puts on both sides, unless the bundle splits or loses
+/// an edge while on both sides. Sides are sorted arrays, so moving
+/// node-sides in or out of a side still moves the rest of it in memory.
+///
+/// Each bundle also collects the node-sides that edits have added to it or
+/// changed the outward edges of, so that whatever a caller keeps per bundle
+/// can be brought up to date from those alone.
+class BundleIndex {
+    private:
+        DeletableHandleGraph* g;
+        bundle_map_t bundle_map;
+        /// Sum of the right degrees of the node-sides mapped to each bundle,
+        /// which tells whether the bundle is balanced
+        std::unordered_map<const Bundle*, size_t> degree_sums;
+        /// Node-sides of a bundle that joined it or whose edges on the
+        /// go_left = true side changed, since the bundle was started or
+        /// they were last taken. Serial numbers come from a counter that
+        /// only goes up, so a bundle the pool hands out again gets a new one.
+        struct Changes {
+            size_t serial;
+            std::unordered_set<handle_t> keys;
+            /// Set once the changes have been taken, after which the bundle
+            /// is reported when it goes back to the pool
+            bool is_taken = false;
+        };
+        std::unordered_map<const Bundle*, Changes> changes;
+        size_t serial = 0;
+        /// Bundles whose changes were taken and that have since gone back to
+        /// the pool
+        std::vector<const Bundle*> released;
+
+        /// Maps the node-sides of the bundle to it
+        void mark(Bundle* bundle);
+        /// Removes the bundle's mappings and returns it to the pool
+        void unmark(Bundle* bundle);
+        /// Forgets the bundle and returns it to the pool
+        void release(Bundle* bundle);
+        /// Gives a new bundle a serial number and no changes
+        void renew(Bundle* bundle);
+        /// Adds the node-side to the changes of its bundle, if it has one
+        void note(const handle_t& key);
+        /// Notes the node-sides an edge from left to right has changed
+        void note_ends(const handle_t& left, const handle_t& right);
+
+        /// Returns true if every node-side of the bundle is on both sides,
+        /// which is the case once it holds a self-inversion. key may be any
+        /// node-side mapped to the bundle.
+        bool is_mirrored(Bundle* bundle, const handle_t& key) const;
+        /// Puts every node-side of the bundle on both sides
+        void close_mirror(Bundle* bundle);
+        /// Sets is_balanced from the degree sum and is_cyclic as given
+        void set_properties(Bundle* bundle, bool is_cyclic);
+
+        /// Returns the bundle of the node-side, starting a bundle with only
+        /// the node-side on its left if it has none
+        Bundle* get_or_start(const handle_t& key);
+        /// Moves the smaller of two bundles into the larger, flipping it if
+        /// needed so the new edge between key_a and key_b goes from one side
+        /// to the other. Returns the bundle left.
+        Bundle* merge(Bundle* a, handle_t key_a, Bundle* b, handle_t key_b);
+
+        /// Updates the bundles for an edge from left to right that has just
+        /// been created or destroyed
+        void add_edge(const handle_t& left, const handle_t& right);
+        void remove_edge(const handle_t& left, const handle_t& right);
+
+        /// Returns true if three edges join the two node-sides, which is how
+        /// most edits leave the ends of a removed edge. Gives up after about
+        /// as many edges as the two node-sides have.
+        bool is_close(const handle_t& key_a, const handle_t& key_b) const;
+        /// Searches the bundle from two of its node-sides at once. Returns
+        /// false if the searches meet, or true with the node-sides found by
+        /// the search that ran out first.
+        bool separate(const handle_t& key_a, const handle_t& key_b, std::vector<handle_t>& part);
+        /// Moves the given node-sides of the bundle into a new bundle
+        void split(Bundle* bundle, const std::vector<handle_t>& part);
+        /// Updates a bundle that had every node-side on both sides after an
+        /// edge between two of its node-sides was removed
+        void settle_mirror(Bundle* bundle, const handle_t& key_a, const handle_t& key_b);
+
+    public:
+        BundleIndex(DeletableHandleGraph* g_) : g(g_) {}
+        ~BundleIndex();
+
+        /// Finds every bundle of the graph, replacing the current ones
+        void build(bool parallel = false);
+
+        /// Returns every bundle to the pool
+        void clear();
+
+        /// The node-side to bundle mapping
+        const bundle_map_t& get_map() const {
+            return bundle_map;
+        }
+
+        /// Returns the bundle of the node-side or nullptr if it has no edges
+        /// on its go_left = false side
+        Bundle* find(const handle_t& handle) const;
+
+        /// Like find, but flips the bundle if needed so the node-side is on
+        /// its left, as find_bundle(handle) would return it
+        Bundle* orient(const handle_t& handle);
+
+        /// Returns the serial number of the bundle, which stays the same
+        /// while it gains node-sides or loses them to other bundles
+        size_t get_serial(const Bundle* bundle) const;
+        /// Returns and forgets the node-sides that joined the bundle or had
+        /// an edge on their go_left = true side created or destroyed, since
+        /// the bundle got its serial number or they were last taken. Some
+        /// may have left it since.
+        std::unordered_set<handle_t> take_changes(const Bundle* bundle);
+        /// Returns and forgets the bundles that have gone back to the pool
+        /// since the last call, out of those whose changes were ever taken.
+        /// Whatever a caller keeps for them is stale. The pool may already
+        /// have handed one out again, with a new serial number.
+        std::vector<const Bundle*> take_released();
+
+        /// Graph edits that keep the bundles up to date. Merging nodes is
+        /// done by creating the merged node's edges and destroying the nodes.
+        void create_edge(const handle_t& left, const handle_t& right);
+        void destroy_edge(const handle_t& left, const handle_t& right);
+        void destroy_handle(const handle_t& handle);
+
+        /// The mapping and the bundles it points to
+        MemoryUsage memory_usage() const;
+};
+
+#endif /* VG_ALGORITHMS_BUNDLE_INDEX_HPP_INCLUDED */
@@ -1,11 +1,11 @@
 #include "decompose.hpp"
 #include <cstdlib>
 #include <functional>
+#include <mutex>
 #include <unordered_map>
 #include <utility>
 #include <queue>
 
-#include "find_bundles.hpp"
 #include <handlegraph/iteratee.hpp>
 
 #ifdef DEBUG_DECOMPOSE
@@ -41,6 +41,7 @@ void DecompositionTreeBuilder::print_node(const handle_t& handle) {
 DecompositionTreeBuilder::DecompositionTreeBuilder(DeletableHandleGraph* g_)
     : g(g_)
     , bpool(BundlePool::get_instance())
+    , bundles(g_)
 {
     // Get the next nid.
     nid_counter = g->max_node_id() + 1;
@@ -50,6 +51,7 @@ DecompositionTreeBuilder::DecompositionTreeBuilder(DeletableHandleGraph* g_)
 }
 
 DecompositionTreeBuilder::~DecompositionTreeBuilder() {
+    bundles.clear();
     bpool->free();
 }
 
@@ -67,32 +69,43 @@ DecompositionNode* DecompositionTreeBuilder::construct_tree() {
     return nullptr;
 }
 
+MemoryUsage DecompositionTreeBuilder::memory_usage() const {
+    MemoryUsage usage("DecompositionTreeBuilder", sizeof(DecompositionTreeBuilder));
+    usage.add("decomp_map", MemoryUsage::of_table(decomp_map));
+    usage.add("updates", MemoryUsage::of_table(updates.updated));
+    usage.add("orbit_indexes", MemoryUsage::of_table(orbit_indexes));
+    usage.add(bundles.memory_usage());
+    usage.add(bpool->memory_usage());
+
+    // The nodes still in the graph map to the tops of the subtrees built so
+    // far. Entries of reduced nodes may point to freed tree nodes, so only
+    // the current nodes are followed.
+    std::vector<const DecompositionNode*> roots;
+    g->for_each_handle([&](const handle_t& handle) {
+        auto it = decomp_map.find(g->get_id(handle));
+        if (it != decomp_map.end() && it->second != nullptr) roots.push_back(it->second);
+    });
+    usage.add(tree_memory_usage(roots));
+    return usage;
+}
+
 void DecompositionTreeBuilder::initialize_bookkeeping() {
-    // Save the initial state of each node's left and right neighbors.
+    // Save the initial state of each node's left and right neighbors. Source
+    // nodes are created in parallel and only the map insertion is serialized.
+    decomp_map.reserve(g->get_node_count());
+    std::mutex decomp_map_lock;
     g->for_each_handle([&](const handle_t& handle) {
         nid_t nid = g->get_id(handle);
 
         // Create decomposition source node.
-        decomp_map[nid] = new DecompositionNode(nid, Source, 
+        DecompositionNode* source = new DecompositionNode(nid, Source, 
                 g->get_is_reverse(handle));
-    });
+        std::lock_guard<std::mutex> guard(decomp_map_lock);
+        decomp_map[nid] = source;
+    }, true);
 }
 
 // Private functions
-void DecompositionTreeBuilder::mark_bundle(Bundle* bundle) {
-    for (auto& handle : bundle->get_left()) bundle_map[handle] = bundle;
-    for (auto& handle : bundle->get_right()) bundle_map[g->flip(handle)] = bundle;
-}
-
-void DecompositionTreeBuilder::unmark_bundle(Bundle* bundle) {
-    // Go through each bundleside and remove their reference.
-    for (auto& handle : bundle->get_left()) bundle_map.erase(handle);
-    for (auto& handle : bundle->get_right()) bundle_map.erase(g->flip(handle));
-
-    // Recycle Bundle object
-    bpool->return_bundle(bundle);
-}
-
 inline void DecompositionTreeBuilder::update_bundle_nodes(Bundle& bundle) {
     for (auto& l_node : bundle.get_left()) updates.updated.insert(l_node);
     for (auto& r_node : bundle.get_right()) updates.updated.insert(g->flip(r_node));
@@ -124,16 +137,11 @@ void DecompositionTreeBuilder::remove_self_cycle_inversion(const handle_t& node)
 #ifdef DEBUG_DECOMPOSE
         std::cout << "\033[31mDeleting self cycle\033[0m" << std::endl;
 #endif /* DEBUG_DECOMPOSE */
-        // Remove original bundle. With unbalanced bundles removing left and 
-        // right would result in a segfault (due to left and right being in 
-        // the same bundle).
-        unmark_bundle(bundle_map[node]);
-        g->destroy_edge(s_cycle);
-        // Recompute bundles.
-        auto [_r, bl] = find_bundle(g->flip(node), *g, false);
-        mark_bundle(bl);
-        auto [_l, br] = find_bundle(node, *g, false);
-        mark_bundle(br);
+        // The bundle may split in two. Orient the bundles of both node-sides
+        // from the node.
+        bundles.destroy_edge(s_cycle.first, s_cycle.second);
+        bundles.orient(g->flip(node));
+        bundles.orient(node);
 
         // Mark self-cycle in decomposition node. 
         decomp_map[g->get_id(node)]->scycle = true;
@@ -145,10 +153,8 @@ void DecompositionTreeBuilder::remove_self_cycle_inversion(const handle_t& node)
 #ifdef DEBUG_DECOMPOSE
         std::cout << "\033[31mDeleting self inversion (L)\033[0m" << std::endl;
 #endif /* DEBUG_DECOMPOSE */
-        unmark_bundle(bundle_map[g->flip(node)]);
-        g->destroy_edge(s_inv_l);
-        auto [_r, bl] = find_bundle(g->flip(node), *g, false);
-        mark_bundle(bl);
+        bundles.destroy_edge(s_inv_l.first, s_inv_l.second);
+        bundles.orient(g->flip(node));
 
         // Mark self-inversion left in decomposition node.
         DecompositionNode* decomp = decomp_map[g->get_id(node)];
@@ -161,10 +167,8 @@ void DecompositionTreeBuilder::remove_self_cycle_inversion(const handle_t& node)
 #ifdef DEBUG_DECOMPOSE
         std::cout << "\033[31mDeleting self inversion (R)\033[0m" << std::endl;
 #endif /* DEBUG_DECOMPOSE */
-        std::cout << "SEG" << std::endl;
-        g->destroy_edge(s_inv_r);
-        auto [_l, br] = find_bundle(node, *g, false);
-        mark_bundle(br);
+        bundles.destroy_edge(s_inv_r.first, s_inv_r.second);
+        bundles.orient(node);
 
         // Mark self-inversion left in decomposition node.
         DecompositionNode* decomp = decomp_map[g->get_id(node)];
@@ -192,27 +196,21 @@ void DecompositionTreeBuilder::perform_reduction1_strict(handle_t& node) {
     handle_t right_neighbor = get_first_neighbor(node, false);
 
     // Destroy original edge between neighbors.
-    g->destroy_edge(left_neighbor, right_neighbor);
+    bundles.destroy_edge(left_neighbor, right_neighbor);
 
     // Create new epsilon node that represents the destroyed edge.
     nid_t nid = nid_counter++;
     handle_t epsilon_node = g->create_handle("", nid); 
 
-    g->create_edge(left_neighbor, epsilon_node);
-    g->create_edge(epsilon_node, right_neighbor);
+    bundles.create_edge(left_neighbor, epsilon_node);
+    bundles.create_edge(epsilon_node, right_neighbor);
     
-    // Update the bundles.
-    // Only unmarking left neighbors since with unbalanced bundles the right
-    // neighbor must be in it.
-    auto obundle = bundle_map[left_neighbor];
-    unmark_bundle(obundle);
-
-    auto [_l, bl] = find_bundle(epsilon_node, *g, false);
-    mark_bundle(bl);
+    // The bundle of the left neighbor (which holds the right neighbor too)
+    // has split into the bundles on either side of the epsilon node.
+    Bundle* bl = bundles.orient(epsilon_node);
     update_bundle_nodes(*bl);
 
-    auto [_r, br] = find_bundle(g->flip(epsilon_node), *g, false);
-    mark_bundle(br);
+    Bundle* br = bundles.orient(g->flip(epsilon_node));
     update_bundle_nodes(*br);
 
     // Also create epsilon node in decomposition map.
@@ -221,7 +219,8 @@ void DecompositionTreeBuilder::perform_reduction1_strict(handle_t& node) {
 }
 
 inline bool DecompositionTreeBuilder::is_reduction2(const handle_t& node) {
-    return bundle_map.count(node) && bundle_map[node]->is_trivial();
+    Bundle* bundle = bundles.find(node);
+    return bundle != nullptr && bundle->is_trivial();
 }
 
 handle_t DecompositionTreeBuilder::reduce_trivial_bundle(Bundle& bundle) {
@@ -235,12 +234,12 @@ handle_t DecompositionTreeBuilder::reduce_trivial_bundle(Bundle& bundle) {
     // For trivial bundles that aren't self cycles.
     // Remap left side edges of l_handle to the new node.
     g->follow_edges(l_handle, true, [&](const handle_t& l_nei) {
-        g->create_edge(l_nei, new_node);
+        bundles.create_edge(l_nei, new_node);
     });
 
     // Remap right side edges of r_handle to new node.
     g->follow_edges(r_handle, false, [&](const handle_t& r_nei) {
-        g->create_edge(new_node, r_nei);
+        bundles.create_edge(new_node, r_nei);
     });
 
 #ifndef DISABLE_BUILD
@@ -248,9 +247,10 @@ handle_t DecompositionTreeBuilder::reduce_trivial_bundle(Bundle& bundle) {
     build_reduction2(g->get_id(new_node), l_handle, r_handle);
 #endif /* DISABLE_BUILD */
 
-    // Destroy the two nodes of this trivial bundle.
-    g->destroy_handle(l_handle);
-    g->destroy_handle(r_handle);
+    // Destroy the two nodes of this trivial bundle. The trivial bundle goes
+    // back to the pool with them.
+    bundles.destroy_handle(l_handle);
+    bundles.destroy_handle(r_handle);
 
     return new_node;
 }
@@ -277,27 +277,16 @@ void DecompositionTreeBuilder::perform_reduction2(Bundle& bundle) {
     // Perform rule 2 reduction.
     handle_t node = reduce_trivial_bundle(bundle);
 
-    // Delete node entries of the trivial bundle in bundle_map.
-    handle_t left = *bundle.get_left().begin();
-    handle_t right = *bundle.get_right().begin();
-    unmark_bundle(&bundle);
-
-    // Delete node entries.
-    // Need to check both left and right in case it has no left/right neighbors.
-    if (bundle_map.count(left)) unmark_bundle(bundle_map[g->flip(left)]);
-    if (bundle_map.count(right)) unmark_bundle(bundle_map[right]);
-
-    // Recompute bundles for the left and right side of the node.
-    // Find the bundle on the left node-side.
-    auto [_, bundle1] = find_bundle(g->flip(node), *g, false);
-    mark_bundle(bundle1);
-    update_bundle_nodes(*bundle1);
+    // Orient the bundles on the left and right side of the node. Either may
+    // not exist if the node has no neighbors on that side.
+    Bundle* bundle1 = bundles.orient(g->flip(node));
+    if (bundle1 != nullptr) update_bundle_nodes(*bundle1);
 
     // Check if the left node-side's bundle has the right node-side. If it does,
-    // then there's no need to recompute the same bundle.
-    if (!bundle_map.count(node)){
-        auto [_, bundle2] = find_bundle(node, *g, false);
-        mark_bundle(bundle2);
+    // then there's no need to visit the same bundle again.
+    Bundle* bundle2 = bundles.find(node);
+    if (bundle2 != nullptr && bundle2 != bundle1) {
+        bundles.orient(node);
         update_bundle_nodes(*bundle2);
     }
 
@@ -310,25 +299,60 @@ std::vector<handle_set_t> DecompositionTreeBuilder::is_reduction3(Bundle& bundle
     // Node-side neighbors->Set of node-sides with these neighbors map
     handle_set_map_t<handle_set_t> nei2orbits;
 
-    // Left side of bundle
-    for (auto& handle : bundle.get_left()) {
+    // Node-sides are grouped by a hash of their outward neighbors. Every
+    // orbit found before has been reduced, so only the groups of node-sides
+    // that changed since can hold a new one. A new bundle starts with all
+    // of its node-sides. The groups of bundles that have gone back to the
+    // pool are dropped first.
+    for (auto released : bundles.take_released()) orbit_indexes.erase(released);
+    handle_set_t changed = bundles.take_changes(&bundle);
+    orbit_index_t& index = orbit_indexes[&bundle];
+    if (index.serial != bundles.get_serial(&bundle)) {
+        index = orbit_index_t();
+        index.serial = bundles.get_serial(&bundle);
+        changed.clear();
+        for (auto& handle : bundle.get_left()) changed.insert(handle);
+        for (auto& handle : bundle.get_right()) changed.insert(g->flip(handle));
+    }
+    std::unordered_set<size_t> touched;
+    for (auto& handle : changed) {
+        auto old_hash = index.hashes.find(handle);
+        if (old_hash != index.hashes.end()) {
+            auto group = index.groups.find(old_hash->second);
+            group->second.erase(handle);
+            if (group->second.empty()) index.groups.erase(group);
+            index.hashes.erase(old_hash);
+        }
+        if (bundles.find(handle) != &bundle) continue;
         handle_set_t neighbors = get_neighbors(g->flip(handle));
         // Skip node-sides with no neighbors
-        if (!neighbors.size()) continue; 
-        nei2orbits[neighbors].insert(handle);
+        if (!neighbors.size()) continue;
+        size_t hash = handle_set_t_hash_fn()(neighbors);
+        index.hashes[handle] = hash;
+        index.groups[hash].insert(handle);
+        touched.insert(hash);
     }
 
-    // Right side of bundle
-    for (auto& handle : bundle.get_right()) {
-        handle_set_t neighbors = get_neighbors(handle);
-        // Skip node-sides with no neighbors
-        if (!neighbors.size()) continue;
-        nei2orbits[neighbors].insert(g->flip(handle));
+    // Touched groups are split by the neighbors themselves. Node-sides that
+    // have left the bundle since they were grouped are dropped.
+    for (auto& hash : touched) {
+        handle_set_t& group = index.groups.at(hash);
+        if (group.size() < 2) continue;
+        for (auto it = group.begin(); it != group.end();) {
+            if (bundles.find(*it) != &bundle) {
+                index.hashes.erase(*it);
+                it = group.erase(it);
+                continue;
+            }
+            nei2orbits[get_neighbors(g->flip(*it))].insert(*it);
+            ++it;
+        }
     }
 
     // Add orbits that have more than one node-side with common neighbors.
     std::vector<handle_set_t> orbits;
     for (auto& [_, orbit_handles] : nei2orbits) {
+        remove_both_orientations(orbit_handles);
         if (orbit_handles.size() > 1) {
             orbits.push_back(orbit_handles);
         }
@@ -336,6 +360,16 @@ std::vector<handle_set_t> DecompositionTreeBuilder::is_reduction3(Bundle& bundle
     return orbits;
 }
 
+void DecompositionTreeBuilder::remove_both_orientations(handle_set_t& orbit) {
+    for (auto it = orbit.begin(); it != orbit.end();) {
+        if (orbit.erase(g->flip(*it))) {
+            it = orbit.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 handle_t DecompositionTreeBuilder::reduce_orbit(handle_set_t& orbit) {
     // Create new handle for retracted node.
     handle_t new_node = g->create_handle("", nid_counter++);
@@ -348,26 +382,21 @@ handle_t DecompositionTreeBuilder::reduce_orbit(handle_set_t& orbit) {
     // Attach all left neighbors (since it's an orbit, this means all outward
     // nodes will be the same).
     g->follow_edges(*orbit.begin(), true, [&](const handle_t& l_nei) {
-        g->create_edge(l_nei, new_node);
+        bundles.create_edge(l_nei, new_node);
     });
 
-    // Unmark inward bundle.
-    handle_t ohandle = g->flip(*orbit.begin());
-    unmark_bundle(bundle_map[ohandle]);
-
     // Attach all right neighbors (since unbalanced bundles are allowed, 
     // inward nodes may not be the same for each node in the orbit).
     // Also destroy orbit nodes since they've been retracted.
     for (auto& o_handle : orbit) {
         g->follow_edges(o_handle, false, [&](const handle_t& r_nei) {
-            g->create_edge(new_node, r_nei);
+            bundles.create_edge(new_node, r_nei);
         });
-        g->destroy_handle(o_handle);
+        bundles.destroy_handle(o_handle);
     }
 
-    // Recompute inward bundle.
-    auto [_, bundle] = find_bundle(g->flip(new_node), *g, false);
-    mark_bundle(bundle);
+    // Orient the outward bundle from the new node.
+    bundles.orient(g->flip(new_node));
 
     return new_node;
 }
@@ -417,11 +446,6 @@ void DecompositionTreeBuilder::build_reduction3(const nid_t new_nid,
 }
 
 void DecompositionTreeBuilder::perform_reduction3(std::vector<handle_set_t> orbits) {
-    // Unmark the bundle that these orbits belong to
-    handle_t o_handle = *(*orbits.begin()).begin();
-    Bundle* o_bundle = bundle_map[o_handle];
-    unmark_bundle(o_bundle);
-
     // Retract orbits.
     handle_t new_node;
     for (auto& orbit : orbits) {
@@ -430,9 +454,8 @@ void DecompositionTreeBuilder::perform_reduction3(std::vector<handle_set_t> orbi
         updates.updated.insert(g->flip(new_node));
     }
 
-    // Reinitialize retracted bundle.
-    auto [_, new_bundle] = find_bundle(new_node, *g, false);
-    mark_bundle(new_bundle);
+    // Orient the retracted bundle from the last new node.
+    bundles.orient(new_node);
 }
 
 void DecompositionTreeBuilder::group_irreducible(std::unordered_set<nid_t> boundary) {
@@ -542,9 +565,7 @@ void DecompositionTreeBuilder::reduce() {
     });
 
     // Initialize bundles that exist in the graph
-    bundle_map.clear();
-    auto bundles = find_bundles(*g, false);
-    for (auto& bundle : bundles) mark_bundle(bundle);
+    bundles.build(true);
 
     // Main algorithm
     while(updates.is_action_avail()) {
@@ -567,9 +588,9 @@ void DecompositionTreeBuilder::reduce() {
             print_node(u);
             std::cout << "\033[35mReduction action 2 available\033[0m" << std::endl;
 #endif /* DEBUG_DECOMPOSE */
-            perform_reduction2(*bundle_map[u]);
+            perform_reduction2(*bundles.find(u));
         // Check Rule 3
-        } else if (bundle_map.count(u) && (orbits = is_reduction3(*bundle_map[u])).size()) {
+        } else if (bundles.find(u) && (orbits = is_reduction3(*bundles.find(u))).size()) {
 #ifdef DEBUG_DECOMPOSE
             print_node(u);
             std::cout << "\033[36mReduction action 3 available\033[0m" << std::endl;
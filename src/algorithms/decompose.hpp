@@ -7,6 +7,7 @@
 
 #include "handle.hpp"
 #include "bundle.hpp"
+#include "bundle_index.hpp"
 #include "decomposition_tree.hpp"
 #include "wang_hash.hpp"
 #include "handlegraph/util.hpp"
@@ -15,9 +16,6 @@
 //#define DISABLE_BUILD
 
 // Declare bookkeeping data structures
-// Keeps track of node-side to bundle
-using bundle_map_t = std::unordered_map<handle_t, Bundle*>;
-
 // Keeps track of a set of handles to type
 using handle_set_t = std::unordered_set<handle_t>;
 struct handle_set_t_hash_fn {
@@ -57,6 +55,15 @@ struct node_update_t {
     }
 };
 
+// Keeps the node-sides of a bundle grouped by the hash of their outward
+// neighbors. The serial number is the one the bundle had when the groups
+// were made.
+struct orbit_index_t {
+    size_t serial = 0;
+    std::unordered_map<handle_t, size_t> hashes;
+    std::unordered_map<size_t, handle_set_t> groups;
+};
+
 /** Decomposition Tree Builder
  * Constructs decomposition tree by reducing a graph.
  */
@@ -76,9 +83,13 @@ private:
     /// Bookkeeping data structures
     // Node-sides that have been updated and need to be checked.
     node_update_t updates;
-    // Maps node-side to corresponding bundle (could not exist if only using
-    // balanced bundle).
-    bundle_map_t bundle_map;
+    // Maps node-side to corresponding bundle and keeps it up to date as the
+    // graph is reduced. Edges of the graph are edited through it.
+    BundleIndex bundles;
+    // Node-sides of each bundle grouped by their outward neighbors, as of
+    // the last time its orbits were looked for. Dropped once the bundle
+    // goes back to the pool.
+    std::unordered_map<const Bundle*, orbit_index_t> orbit_indexes;
     // Maps node to a decomposition node. If it's a source node then there won't
     // be a value (not a default dict).
     std::unordered_map<nid_t, DecompositionNode*> decomp_map;
@@ -86,11 +97,6 @@ private:
     /// Bookkeeping functions
     // Initializes base state of bookkeeping data structures.
     void initialize_bookkeeping();
-    // Creates a node->bundle mappings for each node in the bundle.
-    void mark_bundle(Bundle* bundle);
-    // Removes node->bundle mappings for each node in the bundle and recycles
-    // Bundle object back to the pool.
-    void unmark_bundle(Bundle* bundle);
     // Adds node-sides from bundle to updates.
     inline void update_bundle_nodes(Bundle& bundle);
     // Performs necessary edge renaming if needed.
@@ -131,6 +137,12 @@ private:
     // Rule 3 
     // Returns all orbits with more than one node.
     std::vector<handle_set_t> is_reduction3(Bundle& bundle);
+    // Removes the nodes found in both orientations from an orbit. Such a
+    // node has the same neighbors at both of its ends, so it isn't parallel
+    // to the other node-sides in either orientation. Retracting it would put
+    // it in the tree twice and leave a node of the same shape, found again
+    // as an orbit forever.
+    void remove_both_orientations(handle_set_t& orbit);
     // Handles in the handle_set_t will be oriented inward such that follow_edges
     // with go_left = false will go to nodes of the other bundleside pointing 
     // in the outward direction (away from the bundle).
@@ -156,6 +168,9 @@ public:
     // TODO: Verify that function returns the appropriate object when called 
     // multiple times
     DecompositionNode* construct_tree();
+    // Estimates the memory held by the bookkeeping maps, the bundles they
+    // point to, the bundle pool and the decomposition tree built so far.
+    MemoryUsage memory_usage() const;
     // Group irreducible nodes given boundary set.
     void group_irreducible(std::unordered_set<nid_t> boundary);
 };
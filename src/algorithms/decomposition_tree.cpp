@@ -198,6 +198,36 @@ void free_tree(DecompositionNode *node) {
     }
 }
 
+MemoryUsage tree_memory_usage(const std::vector<const DecompositionNode*>& roots) {
+    // Children can be reached both through the children list and through the
+    // chain, so visited nodes are remembered.
+    std::unordered_set<const DecompositionNode*> visited;
+    std::vector<const DecompositionNode*> stack;
+    for (auto root : roots) {
+        if (root != nullptr && visited.insert(root).second) stack.push_back(root);
+    }
+
+    size_t children = 0;
+    while (!stack.empty()) {
+        const DecompositionNode* node = stack.back();
+        stack.pop_back();
+        if (node->children.capacity()) {
+            children += MemoryUsage::heap_block(MemoryUsage::of(node->children));
+        }
+        for (auto child : node->children) {
+            if (visited.insert(child).second) stack.push_back(child);
+        }
+        for (auto child = node->child_head; child != nullptr; child = child->sibling) {
+            if (visited.insert(child).second) stack.push_back(child);
+        }
+    }
+
+    MemoryUsage usage("DecompositionTree");
+    usage.add("nodes", visited.size() * MemoryUsage::heap_block(sizeof(DecompositionNode)));
+    usage.add("children", children);
+    return usage;
+}
+
 #ifdef DEBUG_DECOMP_TREE
 inline void print_depth(int depth) {
     for (int i = 0; i < depth; i++) {
@@ -4,6 +4,7 @@
 #define DEBUG_DECOMP_TREE
 
 #include "handle.hpp"
+#include "../MemoryUsage.hpp"
 #include <utility>
 #include <vector>
 #include <unordered_map>
@@ -84,6 +85,13 @@ DecompositionNode* find_lca(DecompositionNode* n1, DecompositionNode* n2);
 // Frees decomposition tree given root.
 void free_tree(DecompositionNode* node);
 
+// Estimates the heap held by the decomposition trees below the given roots.
+// Nodes reachable from more than one root are counted once.
+MemoryUsage tree_memory_usage(const std::vector<const DecompositionNode*>& roots);
+inline MemoryUsage tree_memory_usage(const DecompositionNode* root) {
+    return tree_memory_usage(std::vector<const DecompositionNode*>(1, root));
+}
+
 #ifdef DEBUG_DECOMP_TREE
 class DecompositionTreePrinter {
 private:
@@ -1,6 +1,5 @@
 #include "dfs.hpp"
-
-#include <unordered_map>
+#include "handle_index.hpp"
 
 //#define debug
 
@@ -20,9 +19,12 @@ void dfs(
     const unordered_set<handle_t>& sinks                     // when hitting a sink, don't keep walking
     ) {
 
+    // numbering of the node-sides shared by the per-handle containers
+    HandleIndex index(graph);
+
     // to maintain search state
     enum SearchState { PRE = 0, CURR, POST };
-    unordered_map<handle_t, SearchState> state; // implicitly constructed entries will be PRE.
+    HandleVector<SearchState> state(index, SearchState::PRE);
 
     // to maintain stack frames
     struct Frame {
@@ -35,7 +37,7 @@ void dfs(
     };
 
     // maintains edges while the node traversal's frame is on the stack
-    unordered_map<handle_t, vector<edge_t> > edges;
+    HandleVector<vector<edge_t> > edges(index);
 
     // do dfs from given root.  returns true if terminated via break condition, false otherwise
     function<bool(const handle_t&)> dfs_single_source = [&](const handle_t& root) {
@@ -179,7 +181,7 @@ void dfs(
             }
             state[handle] = SearchState::POST;
             handle_end_fn(handle);
-            edges.erase(handle); // clean up edge cache
+            vector<edge_t>().swap(edges[handle]); // clean up edge cache
         }
 
         return false;
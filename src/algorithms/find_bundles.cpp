@@ -1,4 +1,9 @@
 #include "find_bundles.hpp"
+#include "handle_index.hpp"
+#include "../ThreadPool.hpp"
+#include <algorithm>
+#include <memory>
+#include <mutex>
 #include <unordered_set>
 
 using namespace handlegraph;
@@ -19,21 +24,124 @@ using namespace std;
 #endif /* DEBUG_FIND_BUNDLES */
 
 /// Returns true if the handle has been cached or false if otherwise
-inline bool cache(const handle_t& handle, unordered_set<handle_t>& cached) { 
-    return !cached.insert(handle).second;
+inline bool cache(const handle_t& handle, HandleBitset& cached) { 
+    return !cached.insert(handle);
 }
 
-inline bool cache(const handle_t& handle, unordered_set<handle_t>& cached,
+inline bool cache(const handle_t& handle, HandleBitset& cached,
     const HandleGraph& g
 ) { 
-    return !cached.insert(g.flip(handle)).second;
+    return !cached.insert(g.flip(handle));
 }
 
+/// Cache for single bundle lookups, which don't need to remember anything
+struct NoCache {};
+
+inline bool cache(const handle_t&, NoCache&) { 
+    return false;
+}
+
+inline bool cache(const handle_t&, NoCache&, const HandleGraph&) { 
+    return false;
+}
+
+/// Cache for parallel sweeps. The node-sides that would have been marked
+/// are only listed, and find_bundles_parallel claims them once it knows
+/// which thread reports the bundle.
+struct SeenList {
+    vector<handle_t> handles;
+};
+
+inline bool cache(const handle_t& handle, SeenList& seen) { 
+    seen.handles.push_back(handle);
+    return false;
+}
+
+inline bool cache(const handle_t& handle, SeenList& seen,
+    const HandleGraph& g
+) { 
+    seen.handles.push_back(g.flip(handle));
+    return false;
+}
+
+/// Set of node-sides with the same interface as HandleBitset, for lookups
+/// that only touch a few node-sides and can't afford a bit per node-side of
+/// the whole graph.
+class HandleHashSet {
+    private:
+        unordered_set<handle_t> handles;
+
+    public:
+        bool contains(const handle_t& handle) const {
+            return handles.count(handle);
+        }
+
+        bool insert(const handle_t& handle) {
+            return handles.insert(handle).second;
+        }
+
+        void erase(const handle_t& handle) {
+            handles.erase(handle);
+        }
+};
+
+/// Working memory of is_in_bundle, kept between calls so finding a bundle
+/// doesn't allocate. The sides are built up in the vectors, with membership
+/// tracked in the sets, and only copied into the Bundle at the end. Every
+/// call leaves the scratch empty again.
+template<typename Set>
+struct BundleScratch {
+    Set in_left;
+    Set in_right;
+    vector<handle_t> left;
+    vector<handle_t> right;
+    /// Node-sides added since they were last followed (phase 4)
+    vector<handle_t> lhs_new;
+    vector<handle_t> rhs_new;
+
+    BundleScratch() = default;
+    BundleScratch(const HandleIndex& index) : in_left(index), in_right(index) {}
+
+    /// Adds the node-side to the left side. Returns true if it is new.
+    bool add_left(const handle_t& handle) {
+        if (!in_left.insert(handle)) return false;
+        left.push_back(handle);
+        return true;
+    }
+
+    /// Adds the node-side to the right side. Returns true if it is new.
+    bool add_right(const handle_t& handle) {
+        if (!in_right.insert(handle)) return false;
+        right.push_back(handle);
+        return true;
+    }
+
+    /// Copies the sides into the bundle.
+    void fill(Bundle* bundle) const {
+        bundle->get_left().assign(left);
+        bundle->get_right().assign(right);
+    }
+
+    /// Empties the scratch for the next bundle.
+    void clear() {
+        for (const auto& handle : left) in_left.erase(handle);
+        for (const auto& handle : right) in_right.erase(handle);
+        left.clear();
+        right.clear();
+        lhs_new.clear();
+        rhs_new.clear();
+    }
+};
+
 /// Returns a Bundle such that if traversing the left side nodes when 
 /// go_left = false will result in the nodes on the right side of the bundle. 
+/// Visited node-sides are marked in cached, which is a HandleBitset when
+/// sweeping the whole graph and not kept for a single lookup. The sides are
+/// collected in scratch, whose sets are bitsets or hash sets to match.
 // TODO: Rewrite algorithm's pseudocode
+template<typename Cache, typename Set>
 pair<bool, Bundle*> is_in_bundle(const handle_t& handle, const HandleGraph& g,
-    unordered_set<handle_t>& cached, bool is_balanced
+    Cache& cached, BundleScratch<Set>& scratch, bool is_balanced
 ) {
 #ifdef DEBUG_FIND_BUNDLES
     cout << "### " << node_str(handle, g) << " ###" << endl;
@@ -45,47 +153,47 @@ pair<bool, Bundle*> is_in_bundle(const handle_t& handle, const HandleGraph& g,
     // Flag to check if the bundle is balanced (complete bipartite).
     // Yohei proved that all node-sides belong in some bundle (bipartite). 
     bool is_not_balanced_bundle = false;
-    bool handle_dir = g.get_is_reverse(handle);
+    vector<handle_t>& left = scratch.left;
+    vector<handle_t>& right = scratch.right;
 
     // Phase 1: Find right side nodes
     g.follow_edges(handle, false, [&](const handle_t& rhs_handle) {
-        bundle->get_right().add_init_node(rhs_handle);
+        scratch.add_right(rhs_handle);
     });
 
     // If the node-side has no neighbors.
-    if (!bundle->get_right().size()) {
+    if (right.empty()) {
         return pair<bool, Bundle*>(false, bundle);
     }
 
 #ifdef DEBUG_FIND_BUNDLES
     cout << "[Phase 1] RHS nodes:" << endl;
     int count = 1;
-    for (const auto& rhs_handle : bundle->get_right()) {
+    for (const auto& rhs_handle : right) {
         cout << "  " << count << ". " << node_str(rhs_handle, g) << endl;
         count++;
     }
 #endif /* DEBUG_FIND_BUNDLES */
 
     // Phase 2: Find left side nodes and verify all lhs sets are the same
-    // All left node-side handles that aren't part of a balanced bundle set. 
-    // Only used if we're looking for all bundles (is_balanced = false).
-    unordered_set<handle_t> lhs_new; 
-    // Flag for the first node. The first node's neighbors are used to compare
-    // against all other bundle-side node's neighbors.
-    bool is_first = true;
+    // All left node-side handles that aren't part of a balanced bundle set
+    // go in scratch.lhs_new. Only used if we're looking for all bundles
+    // (is_balanced = false).
+    // The first node's neighbors are used to compare against all other
+    // bundle-side node's neighbors.
     int lhs_node_count = 0;
-    for (const auto& rhs_handle : bundle->get_right()) {
+    for (size_t i = 0; i < right.size(); i++) {
+        const handle_t rhs_handle = right[i];
         // Mark node-side as traversed.
         cache(rhs_handle, cached, g);
-        if (is_first) {
+        if (i == 0) {
             // For each neighbor of the init node, add it to the left 
             // bundle-side.
             g.follow_edges(rhs_handle, true, [&](const handle_t& lhs_handle) {
-                bundle->get_left().add_init_node(lhs_handle);
+                scratch.add_left(lhs_handle);
                 cache(lhs_handle, cached);
                 lhs_node_count++;
             });
-            is_first = false;
         } else {
             // Counter to track the number of neighbors of the current 
             // right bundle-side node. If the bundle is balanced the neighbor
@@ -95,9 +203,9 @@ pair<bool, Bundle*> is_in_bundle(const handle_t& handle, const HandleGraph& g,
             g.follow_edges(rhs_handle, true, [&](const handle_t& lhs_handle) {
                 // If a new node-side is inserted, this means that the neighbors
                 // of this node is not the same as the init node.
-                if (bundle->get_left().add_node(lhs_handle)) {
+                if (scratch.add_left(lhs_handle)) {
                     is_not_balanced_bundle = true;
-                    lhs_new.insert(lhs_handle);
+                    scratch.lhs_new.push_back(lhs_handle);
                 }
                 cache(lhs_handle, cached);
                 node_count++;
@@ -109,7 +217,7 @@ pair<bool, Bundle*> is_in_bundle(const handle_t& handle, const HandleGraph& g,
 #ifdef DEBUG_FIND_BUNDLES
     cout << "[Phase 2] LHS nodes:" << endl;
     count = 1;
-    for (const auto& lhs_handle : bundle->get_left()) {
+    for (const auto& lhs_handle : left) {
         cout << "  " << count << ". " << node_str(lhs_handle, g) << endl;
         count++;
     }
@@ -117,22 +225,23 @@ pair<bool, Bundle*> is_in_bundle(const handle_t& handle, const HandleGraph& g,
 #endif /* DEBUG_FIND_BUNDLES */
 
     // Phase 3: Find right side nodes and verify all rhs sets are the same
-    // All right node-side handles that aren't part of a balanced bundle set. 
-    // Only used if we're looking for all bundles (is_balanced = false).
-    unordered_set<handle_t> rhs_new;
+    // All right node-side handles that aren't part of a balanced bundle set
+    // go in scratch.rhs_new. Only used if we're looking for all bundles
+    // (is_balanced = false).
     // The number of nodes that are expected to be on the right node-side.
     // This will be used to verify that the neighbors of any node from the left
     // node-side matches what's currently saved (only for is_balanced = true)
-    int rhs_node_count = bundle->get_right().size();
-    for (const auto& lhs_handle : bundle->get_left()) {
+    int rhs_node_count = right.size();
+    for (size_t i = 0; i < left.size(); i++) {
+        const handle_t lhs_handle = left[i];
         if (lhs_handle != handle) {
             // Counter to track the number of neighbors of the current left
             // bundle-side node
             int node_count = 0;
             g.follow_edges(lhs_handle, false, [&](const handle_t& rhs_handle) {
-                if (bundle->get_right().add_node(rhs_handle)) {
+                if (scratch.add_right(rhs_handle)) {
                     is_not_balanced_bundle = true;
-                    rhs_new.insert(rhs_handle);
+                    scratch.rhs_new.push_back(rhs_handle);
                 }
                 cache(rhs_handle, cached, g);
                 node_count++;
@@ -145,7 +254,7 @@ pair<bool, Bundle*> is_in_bundle(const handle_t& handle, const HandleGraph& g,
     cout << "[Phase 3] RHS nodes:" << endl;
     count = 1;
     
-    for (const auto& rhs_handle : bundle->get_right()) {
+    for (const auto& rhs_handle : right) {
         cout << "  " << count << ". " << node_str(rhs_handle, g) << endl;
         count++;
     }
@@ -157,6 +266,8 @@ pair<bool, Bundle*> is_in_bundle(const handle_t& handle, const HandleGraph& g,
     // Phase 4: If the bundle is not balanced and is_balance = false, continue
     // looking for nodes on both sides.
     if (!is_balanced) {
+        vector<handle_t>& lhs_new = scratch.lhs_new;
+        vector<handle_t>& rhs_new = scratch.rhs_new;
         while (lhs_new.size() || rhs_new.size()) {
 #ifdef DEBUG_FIND_BUNDLES
                 cout << "--------- Unbalanced nodeside finding iteration " << iteration++ << " ---------" << endl;
@@ -167,8 +278,8 @@ pair<bool, Bundle*> is_in_bundle(const handle_t& handle, const HandleGraph& g,
                 cout << "### LHS " << node_str(lhs_handle, g) << " ###" << endl;
 #endif /* DEBUG_FIND_BUNDLES */
                 g.follow_edges(lhs_handle, false, [&](const handle_t& rhs_handle) {
-                    if (bundle->get_right().add_node(rhs_handle)) {
-                        rhs_new.insert(rhs_handle);
+                    if (scratch.add_right(rhs_handle)) {
+                        rhs_new.push_back(rhs_handle);
                         cache(rhs_handle, cached, g);
                     }
                 });
@@ -180,8 +291,8 @@ pair<bool, Bundle*> is_in_bundle(const handle_t& handle, const HandleGraph& g,
                 cout << "### RHS " << node_str(rhs_handle, g) << " ###" << endl;
 #endif /* DEBUG_FIND_BUNDLES */
                 g.follow_edges(rhs_handle, true, [&](const handle_t& lhs_handle) {
-                    if (bundle->get_left().add_node(lhs_handle)) {
-                        lhs_new.insert(lhs_handle);
+                    if (scratch.add_left(lhs_handle)) {
+                        lhs_new.push_back(lhs_handle);
                         cache(lhs_handle, cached);
                     }
                 });
@@ -190,38 +301,140 @@ pair<bool, Bundle*> is_in_bundle(const handle_t& handle, const HandleGraph& g,
         }
     }
 
-    // Phase Descriptor: Describe bundle characteristics
-    bundle->set_balanced(!is_not_balanced_bundle);
-    bundle->define_properties(g);
-
     // If the bundle found is not balanced and we're looking for balanced
-    // bundles.
-    if (is_balanced && is_not_balanced_bundle) 
+    // bundles, the bundle object goes back to the pool unfilled.
+    if (is_balanced && is_not_balanced_bundle) {
+        scratch.clear();
+        BundlePool::get_instance()->return_bundle(bundle);
         return pair<bool, Bundle*>(false, nullptr);
+    }
+
+    // Phase Descriptor: Describe bundle characteristics
+    scratch.fill(bundle);
+    scratch.clear();
+    bundle->set_balanced(!is_not_balanced_bundle);
+    bundle->define_properties();
     return pair<bool, Bundle*>(true, bundle);
 }
 
 pair<bool, Bundle*> find_bundle(const handle_t& handle, const HandleGraph& g,
         bool is_balanced) {
-    unordered_set<handle_t> cache;
-    auto [is_bundle, bundle] = is_in_bundle(handle, g, cache, is_balanced);
+    /// Lookups are repeated after every reduction, so the scratch is reused
+    thread_local BundleScratch<HandleHashSet> scratch;
+    NoCache cache;
+    auto [is_bundle, bundle] = is_in_bundle(handle, g, cache, scratch, is_balanced);
     return pair<bool, Bundle*>(is_bundle, bundle);
 }
 
-vector<Bundle*> find_bundles(const HandleGraph& g, bool is_balanced) {
+/// Finds all bundles with the node-sides split across threads in blocks.
+/// A bundle can be reached from any of its node-sides, and every node-side
+/// marked while finding it finds the same bundle, so the thread that started
+/// from the first of them (in HandleIndex order) reports it. Other threads
+/// that reach the bundle discard their copy and claim its node-sides,
+/// except that first one, so the bundle is found again at most a few times
+/// where blocks meet. Every worker's sets share the one HandleIndex.
+static vector<Bundle*> find_bundles_parallel(const HandleGraph& g, bool is_balanced) {
+    /// Nodes handed out one block at a time
+    static const size_t BLOCK_SIZE = 1024;
+
+    /// State of one thread, reused for the blocks it takes
+    struct Worker {
+        BundleScratch<HandleBitset> scratch;
+        SeenList seen;
+        /// (index of the node-side it was found from, bundle)
+        vector<pair<size_t, Bundle*>> found;
+
+        Worker(const HandleIndex& index) : scratch(index) {}
+    };
+
+    BundlePool* pool = BundlePool::get_instance();
+    vector<handle_t> handles;
+    handles.reserve(g.get_node_count());
+    g.for_each_handle([&](const handle_t& handle) {
+        handles.push_back(handle);
+    });
+
+    HandleIndex index(g);
+    AtomicHandleBitset claimed(index);
+    vector<unique_ptr<Worker>> workers;
+    vector<Worker*> idle;
+    mutex workers_lock;
+
+    auto find_from = [&](const handle_t& handle, Worker& worker) {
+        if (!claimed.insert(handle)) return;
+        worker.seen.handles.clear();
+        auto [is_bundle, bundle] = is_in_bundle(handle, g, worker.seen,
+                worker.scratch, is_balanced);
+
+        size_t start = index(handle);
+        size_t first = start;
+        for (const auto& seen : worker.seen.handles) first = min(first, index(seen));
+        bool is_owner = is_bundle && first == start;
+        for (const auto& seen : worker.seen.handles) {
+            if (!is_bundle || is_owner || index(seen) != first) claimed.insert(seen);
+        }
+
+        if (is_owner) {
+            worker.found.emplace_back(start, bundle);
+        } else if (bundle) {
+            pool->return_bundle(bundle);
+        }
+    };
+
+    size_t block_count = (handles.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    ThreadPool::get_instance().parallel_for(block_count, [&](size_t block) {
+        Worker* worker;
+        {
+            lock_guard<mutex> guard(workers_lock);
+            if (idle.empty()) {
+                workers.emplace_back(new Worker(index));
+                idle.push_back(workers.back().get());
+            }
+            worker = idle.back();
+            idle.pop_back();
+        }
+
+        size_t end = min(handles.size(), (block + 1) * BLOCK_SIZE);
+        for (size_t i = block * BLOCK_SIZE; i < end; i++) {
+            find_from(handles[i], *worker);
+            find_from(g.flip(handles[i]), *worker);
+        }
+
+        lock_guard<mutex> guard(workers_lock);
+        idle.push_back(worker);
+        return true;
+    });
+
+    /// Report the bundles in the order of the node-sides they were found from
+    vector<pair<size_t, Bundle*>> found;
+    for (const auto& worker : workers) {
+        found.insert(found.end(), worker->found.begin(), worker->found.end());
+    }
+    sort(found.begin(), found.end());
+    vector<Bundle*> bundles;
+    bundles.reserve(found.size());
+    for (const auto& entry : found) bundles.push_back(entry.second);
+    return bundles;
+}
+
+vector<Bundle*> find_bundles(const HandleGraph& g, bool is_balanced, bool parallel) {
+    if (parallel) return find_bundles_parallel(g, is_balanced);
+
     vector<Bundle*> bundles;
-    unordered_set<handle_t> cached;
+    HandleIndex index(g);
+    HandleBitset cached(index);
+    BundleScratch<HandleBitset> scratch(index);
 
     g.for_each_handle([&](const handle_t& handle) {
         if (!cache(handle, cached)) {
-            auto [r_is_bundle, r_bundle] = is_in_bundle(handle, g, cached,
+            auto [r_is_bundle, r_bundle] = is_in_bundle(handle, g, cached, scratch,
                     is_balanced);
             if (r_is_bundle) bundles.push_back(r_bundle);
         }
 
         handle_t reversed = g.flip(handle);
         if (!cache(reversed, cached)) {
-            auto [l_is_bundle, l_bundle] = is_in_bundle(reversed, g, cached,
+            auto [l_is_bundle, l_bundle] = is_in_bundle(reversed, g, cached, scratch,
                     is_balanced);
             if (l_is_bundle) bundles.push_back(l_bundle);
         }
@@ -14,8 +14,12 @@
 /// Returns all bundles that have been found. The return format will
 /// be a vector of pairs of vectors containing handles. Each pair
 /// will denote the left side and the right side of a bundle.
+/// If parallel is true the node-sides are split across the threads of the
+/// ThreadPool. Each bundle is still found once, and is reported from the
+/// node-side that comes first in the graph's handle numbering, in that
+/// order. For a BidirectedGraph that is the same result as the serial sweep.
 std::vector<Bundle*> find_bundles(const handlegraph::HandleGraph& g, 
-        bool is_balanced);
+        bool is_balanced, bool parallel = false);
 
 /// Determines if the given handle is part of a bundle. go_left = false.
 /// Returns (true, bundle) if it's in a bundle
@@ -0,0 +1,155 @@
+#ifndef VG_ALGORITHMS_HANDLE_INDEX_HPP_INCLUDED
+#define VG_ALGORITHMS_HANDLE_INDEX_HPP_INCLUDED
+
+/**
+ * \file handle_index.hpp
+ *
+ * Dense numbering of a graph's node-sides, and flat per-handle storage built
+ * on it for algorithms that would otherwise key hash maps by handle_t.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "handle.hpp"
+
+/// Numbers the node-sides (handles) of a graph with indexes in [0, size()).
+/// The two orientations of a node get neighbouring indexes. While the
+/// graph's IDs are compact the index is computed from the ID, the same way
+/// BidirectedGraph lays out its slots, and IDs missing from the range keep
+/// their indexes: for N nodes size() is then up to 2 * (4N + 1024).
+/// Otherwise each node is ranked once when the index is built and size() is
+/// exactly 2N. The index describes the graph as it was when the index was
+/// built.
+class HandleIndex {
+    private:
+        const HandleGraph* g;
+        nid_t min_id = 0;
+        size_t node_slots = 0;
+        bool is_hashed = false;
+        /// Rank of each node, only used if is_hashed
+        std::unordered_map<nid_t, size_t> ranks;
+
+        /// A range of IDs may span this many IDs per node (plus DENSE_SLACK)
+        /// before nodes are ranked instead
+        static const size_t DENSE_FACTOR = 4;
+        static const size_t DENSE_SLACK = 1024;
+
+    public:
+        HandleIndex(const HandleGraph& g_) : g(&g_) {
+            size_t count = g->get_node_count();
+            if (count == 0) return;
+            min_id = g->min_node_id();
+            size_t range = static_cast<size_t>(g->max_node_id() - min_id) + 1;
+            if (range <= DENSE_FACTOR * count + DENSE_SLACK) {
+                node_slots = range;
+                return;
+            }
+            is_hashed = true;
+            ranks.reserve(count);
+            g->for_each_handle([&](const handle_t& handle) {
+                ranks.emplace(g->get_id(handle), ranks.size());
+            });
+            node_slots = ranks.size();
+        }
+
+        /// Number of indexes handed out, i.e. twice the number of node slots,
+        /// which counts unused IDs while the index is computed from IDs.
+        size_t size() const {
+            return 2 * node_slots;
+        }
+
+        /// Returns the index of the node-side. Throws std::out_of_range for a
+        /// node the index doesn't cover, whether IDs are ranked or not.
+        size_t operator()(const handle_t& handle) const {
+            nid_t id = g->get_id(handle);
+            size_t slot = is_hashed ? ranks.at(id) : static_cast<size_t>(id - min_id);
+            if (slot >= node_slots) throw std::out_of_range("HandleIndex: no such node");
+            return 2 * slot + g->get_is_reverse(handle);
+        }
+};
+
+/// Flat array holding a T for every node-side of a graph. Entries start out
+/// as the given value. The index is shared, not copied, and must outlive
+/// the array; one index serves every container of an algorithm run.
+template<typename T>
+class HandleVector {
+    private:
+        const HandleIndex* index;
+        std::vector<T> values;
+
+    public:
+        HandleVector(const HandleIndex& index_, const T& value = T()) : index(&index_), values(index->size(), value) {}
+
+        T& operator[](const handle_t& handle) {
+            return values[(*index)(handle)];
+        }
+
+        const T& operator[](const handle_t& handle) const {
+            return values[(*index)(handle)];
+        }
+};
+
+/// Set of node-sides of a graph, stored as one bit per node-side. The index
+/// is shared like HandleVector's.
+class HandleBitset {
+    private:
+        const HandleIndex* index;
+        std::vector<uint64_t> words;
+
+    public:
+        HandleBitset(const HandleIndex& index_) : index(&index_), words((index->size() + 63) / 64, 0) {}
+
+        bool contains(const handle_t& handle) const {
+            size_t i = (*index)(handle);
+            return (words[i / 64] >> (i % 64)) & 1;
+        }
+
+        /// Adds the node-side. Returns true if it wasn't in the set yet.
+        bool insert(const handle_t& handle) {
+            size_t i = (*index)(handle);
+            uint64_t bit = uint64_t(1) << (i % 64);
+            bool is_new = !(words[i / 64] & bit);
+            words[i / 64] |= bit;
+            return is_new;
+        }
+
+        void erase(const handle_t& handle) {
+            size_t i = (*index)(handle);
+            words[i / 64] &= ~(uint64_t(1) << (i % 64));
+        }
+};
+
+/// Set of node-sides that several threads may add to at once. Adding is a
+/// single atomic or, so exactly one thread sees each node-side as new. The
+/// index is shared like HandleVector's.
+class AtomicHandleBitset {
+    private:
+        const HandleIndex* index;
+        std::unique_ptr<std::atomic<uint64_t>[]> words;
+
+    public:
+        AtomicHandleBitset(const HandleIndex& index_) : index(&index_), words(new std::atomic<uint64_t>[(index->size() + 63) / 64]) {
+            for (size_t i = 0; i < (index->size() + 63) / 64; i++) {
+                words[i].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        bool contains(const handle_t& handle) const {
+            size_t i = (*index)(handle);
+            return (words[i / 64].load(std::memory_order_relaxed) >> (i % 64)) & 1;
+        }
+
+        /// Adds the node-side. Returns true if no thread had added it yet.
+        bool insert(const handle_t& handle) {
+            size_t i = (*index)(handle);
+            uint64_t bit = uint64_t(1) << (i % 64);
+            return !(words[i / 64].fetch_or(bit, std::memory_order_relaxed) & bit);
+        }
+};
+
+#endif /* VG_ALGORITHMS_HANDLE_INDEX_HPP_INCLUDED */
@@ -1,4 +1,5 @@
 #include "is_single_stranded.hpp"
+#include "handle_index.hpp"
 using namespace std;
 
 vector<handle_t> single_stranded_orientation(const HandleGraph* graph) {
@@ -7,15 +8,17 @@ vector<handle_t> single_stranded_orientation(const HandleGraph* graph) {
     vector<handle_t> orientation;
     orientation.reserve(graph->get_node_count());
     
-    // keep track of which nodes have already been oriented and which orientation
-    unordered_map<id_t, bool> recorded_orientation;
+    // keep track of which nodes have already been oriented and which orientation,
+    // by recording the handle of the orientation
+    HandleIndex index(*graph);
+    HandleBitset recorded_orientation(index);
     
     // keep track of whether we've encountered a node in two orientations
     bool failed = false;
     
     // DFS through the graph
     graph->for_each_handle([&](const handle_t& handle) {
-        if (recorded_orientation.count(graph->get_id(handle))) {
+        if (recorded_orientation.contains(handle) || recorded_orientation.contains(graph->flip(handle))) {
             return true;
         }
         
@@ -24,13 +27,12 @@ vector<handle_t> single_stranded_orientation(const HandleGraph* graph) {
         
         // record the orientation of the seed for the traversal
         orientation.push_back(handle);
-        recorded_orientation[graph->get_id(handle)] = graph->get_is_reverse(handle);
+        recorded_orientation.insert(handle);
         
         function<bool(const handle_t&)> walk_edges = [&](const handle_t& next) {
-            auto iter = recorded_orientation.find(graph->get_id(next));
-            if (iter != recorded_orientation.end()) {
+            if (recorded_orientation.contains(next) || recorded_orientation.contains(graph->flip(next))) {
                 // we've been here before, but make sure we're encountering it in the same orientation
-                failed = (iter->second != graph->get_is_reverse(next));
+                failed = !recorded_orientation.contains(next);
             }
             else {
                 // add to the DFS stack
@@ -38,7 +40,7 @@ vector<handle_t> single_stranded_orientation(const HandleGraph* graph) {
                 
                 // record the orientation we encountered it in
                 orientation.push_back(next);
-                recorded_orientation[graph->get_id(next)] = graph->get_is_reverse(next);
+                recorded_orientation.insert(next);
             }
             // continue if we haven't failed
             return !failed;
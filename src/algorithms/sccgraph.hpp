@@ -14,6 +14,9 @@
 #include "../../deps/handlegraph/handle_graph.hpp"
 #include "../../deps/handlegraph/util.hpp"
 
+#include "../MemoryUsage.hpp"
+#include "../ThreadPool.hpp"
+
 using namespace std;
 using namespace handlegraph;
 
@@ -68,6 +71,9 @@ class SCCGraph : public HandleGraph {
         /// largest ID is unavailable. Return value is unspecified if the graph is empty.
         nid_t max_node_id() const;
 
+        /// Return an estimate of the memory held by the SCC edge lists
+        MemoryUsage memory_usage() const;
+
     protected:
         
         /// Loop over all the handles to next/previous (right/left) nodes. Passes
@@ -257,6 +263,17 @@ nid_t SCCGraph::max_node_id() const {
     return max_node;
 }
 
+MemoryUsage SCCGraph::memory_usage() const {
+    MemoryUsage usage("SCCGraph", sizeof(SCCGraph));
+    MemoryUsage& table = usage.add("edges", MemoryUsage::of_table(edges));
+    size_t lists = 0;
+    for (const auto& node_edges : edges) {
+        if (node_edges.second.capacity()) lists += MemoryUsage::heap_block(MemoryUsage::of(node_edges.second));
+    }
+    table.add("lists", lists);
+    return usage;
+}
+
 bool SCCGraph::follow_edges_impl(const handle_t& handle, bool go_left, const std::function<bool(const handle_t&)>& iteratee) const {
     sccid_t node_id  = get_id(handle);
     bool  is_reverse = get_is_reverse(handle);
@@ -272,6 +289,13 @@ bool SCCGraph::follow_edges_impl(const handle_t& handle, bool go_left, const std
         
 
 bool SCCGraph::for_each_handle_impl(const std::function<bool(const handle_t&)>& iteratee, bool parallel) const {
+    /// SCC IDs are exactly 0..N-1, so the ID range can be split across threads
+    if (parallel) {
+        return ThreadPool::get_instance().parallel_for(edges.size(), [&](size_t scc) {
+            return iteratee(get_handle(scc, false));
+        });
+    }
+
     for (const auto& node_edges : edges) {
         if (!iteratee(get_handle(node_edges.first, false))) {
             return false;
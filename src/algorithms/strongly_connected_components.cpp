@@ -1,7 +1,7 @@
 #include "strongly_connected_components.hpp"
 
 //#define debug
-#include <unordered_map>
+#include "handle_index.hpp"
 
 using namespace std;
 
@@ -29,14 +29,16 @@ vector<unordered_set<nid_t>> strongly_connected_components(const HandleGraph* ha
     
     // What node visit step are we on?
     int64_t index = 0;
+    // Numbering of the node-sides shared by the per-handle containers
+    HandleIndex handle_index(*handle_graph);
     // What's the search root from which a node was reached?
-    unordered_map<handle_t, handle_t> roots;
+    HandleVector<handle_t> roots(handle_index);
     // At what index step was each node discovered?
-    unordered_map<handle_t, int64_t> discover_idx;
+    HandleVector<int64_t> discover_idx(handle_index);
     // We need our own copy of the DFS stack
     vector<handle_t> stack;
     // And our own set of nodes already on the stack
-    unordered_set<handle_t> on_stack;
+    HandleBitset on_stack(handle_index);
     // What components did we find? Because of the way strongly connected
     // components generalizes, both orientations of a node always end up in the
     // same component.
@@ -65,7 +67,7 @@ vector<unordered_set<nid_t>> strongly_connected_components(const HandleGraph* ha
         // Go through all the NodeTraversals reachable reading onwards from this traversal.
         handle_graph->follow_edges(trav, false, [&](const handle_t& next) {
 
-            if (on_stack.count(next)) {
+            if (on_stack.contains(next)) {
                 // If any of those NodeTraversals are on the stack already
 
                 auto& node_root = roots[trav];
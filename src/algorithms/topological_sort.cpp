@@ -1,50 +1,46 @@
 #include "topological_sort.hpp"
+#include "handle_index.hpp"
+#include <algorithm>
+#include <mutex>
 #include <unordered_set>
 
 using namespace std;
 
-vector<handle_t> head_nodes(const HandleGraph* g) {
+/// Finds the nodes with no edges on the given side. Nodes are checked in
+/// parallel and returned sorted by ID so the result doesn't depend on
+/// scheduling.
+static vector<handle_t> unconnected_nodes(const HandleGraph* g, bool go_left) {
     vector<handle_t> to_return;
+    mutex to_return_lock;
     g->for_each_handle([&](const handle_t& found) {
         // For each (locally forward) node
         
-        bool no_left_edges = true;
-        g->follow_edges(found, true, [&](const handle_t& ignored) {
-            // We found a left edge!
-            no_left_edges = false;
+        bool no_edges = true;
+        g->follow_edges(found, go_left, [&](const handle_t& ignored) {
+            // We found an edge!
+            no_edges = false;
             // We only need one
             return false;
         });
         
-        if (no_left_edges) {
+        if (no_edges) {
+            lock_guard<mutex> guard(to_return_lock);
             to_return.push_back(found);
         }
+    }, true);
+
+    sort(to_return.begin(), to_return.end(), [&](const handle_t& a, const handle_t& b) {
+        return g->get_id(a) < g->get_id(b);
     });
-    
     return to_return;
-    
+}
+
+vector<handle_t> head_nodes(const HandleGraph* g) {
+    return unconnected_nodes(g, true);
 }
 
 vector<handle_t> tail_nodes(const HandleGraph* g) {
-    vector<handle_t> to_return;
-    g->for_each_handle([&](const handle_t& found) {
-        // For each (locally forward) node
-        
-        bool no_right_edges = true;
-        g->follow_edges(found, false, [&](const handle_t& ignored) {
-            // We found a right edge!
-            no_right_edges = false;
-            // We only need one
-            return false;
-        });
-        
-        if (no_right_edges) {
-            to_return.push_back(found);
-        }
-    });
-    
-    return to_return;
-    
+    return unconnected_nodes(g, false);
 }
 
 vector<handle_t> topological_order(const HandleGraph* g) {
@@ -81,13 +77,17 @@ vector<handle_t> topological_order(const HandleGraph* g) {
     }
 
     // We will use an ordered map handles by ID for nodes we have not visited
-    // yet. This ensures a consistent sort order across systems.
+    // yet. This ensures a consistent sort order across systems. The same
+    // nodes are flagged by their forward handles for quick lookups.
     vg::hash_map<nid_t, handle_t> unvisited;
+    HandleIndex index(*g);
+    HandleBitset is_unvisited(index);
     g->for_each_handle([&](const handle_t& found) {
         if (!s.count(g->get_id(found))) {
             // Only nodes that aren't yet in s are unvisited.
             // Nodes in s are visited but just need to be added tot he ordering.
             unvisited.emplace(g->get_id(found), found);
+            is_unvisited.insert(found);
         }
     });
 
@@ -99,7 +99,7 @@ vector<handle_t> topological_order(const HandleGraph* g) {
             // Look at the first seed
             auto first_seed = (*seeds.begin()).second;
 
-            if(unvisited.count(g->get_id(first_seed))) {
+            if(is_unvisited.contains(g->get_handle(g->get_id(first_seed)))) {
                 // We have an unvisited seed. Use it
 #ifdef debug
 #pragma omp critical (cerr)
@@ -108,6 +108,7 @@ vector<handle_t> topological_order(const HandleGraph* g) {
 
                 s[g->get_id(first_seed)] = first_seed;
                 unvisited.erase(g->get_id(first_seed));
+                is_unvisited.erase(g->get_handle(g->get_id(first_seed)));
             }
             // Whether we used the seed or not, don't keep it around
             seeds.erase(seeds.begin());
@@ -122,6 +123,7 @@ vector<handle_t> topological_order(const HandleGraph* g) {
 #endif
 
             s[unvisited.begin()->first] = unvisited.begin()->second;
+            is_unvisited.erase(unvisited.begin()->second);
             unvisited.erase(unvisited.begin()->first);
         }
 
@@ -141,7 +143,7 @@ vector<handle_t> topological_order(const HandleGraph* g) {
             // reversing self loop on a cycle entry point is a special case of
             // this.
             g->follow_edges(n, true, [&](const handle_t& prev_node) {
-                if(!unvisited.count(g->get_id(prev_node))) {
+                if(!is_unvisited.contains(g->get_handle(g->get_id(prev_node)))) {
                     // Look at the edge
                     auto edge = g->edge_handle(prev_node, n);
                     if (masked_edges.count(edge)) {
@@ -195,7 +197,7 @@ vector<handle_t> topological_order(const HandleGraph* g) {
                 // Mask the edge
                 masked_edges.insert(edge);
 
-                if(unvisited.count(g->get_id(next_node))) {
+                if(is_unvisited.contains(g->get_handle(g->get_id(next_node)))) {
                     // We haven't already started here as an arbitrary cycle entry point
 
 #ifdef debug
@@ -228,6 +230,7 @@ vector<handle_t> topological_order(const HandleGraph* g) {
                         // Remember that we've visited and oriented this node, so we
                         // don't need to use it as a seed.
                         unvisited.erase(g->get_id(next_node));
+                        is_unvisited.erase(g->get_handle(g->get_id(next_node)));
 
                     } else if(!seeds.count(g->get_id(next_node))) {
                         // We came to this node in this orientation; when we need a
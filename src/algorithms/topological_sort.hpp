@@ -14,10 +14,10 @@
 
 using namespace std;
 
-/// Find all of the nodes with no edges on their left sides.
+/// Find all of the nodes with no edges on their left sides, in ID order.
 vector<handle_t> head_nodes(const HandleGraph* g);
 
-/// Find all of the nodes with no edges on their right sides.
+/// Find all of the nodes with no edges on their right sides, in ID order.
 vector<handle_t> tail_nodes(const HandleGraph* g);
 
 /**
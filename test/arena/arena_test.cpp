@@ -0,0 +1,97 @@
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../../src/SequenceArena.hpp"
+#include "handlegraph/util.hpp"
+
+using namespace std;
+
+/// Checks that the span reads back as sequence in both orientations, whole,
+/// base by base and through sub-views. Returns the number of mismatches.
+int check_span(const SequenceArena& arena, const SequenceSpan& span, const string& sequence,
+        const string& name) {
+    int mismatches = 0;
+    string reverse = handlegraph::reverse_complement(sequence);
+    string decoded;
+    arena.decode(span, false, decoded);
+    if (decoded != sequence) {
+        cout << name << ": decoded " << decoded << " instead of " << sequence << endl;
+        mismatches++;
+    }
+    arena.decode(span, true, decoded);
+    if (decoded != reverse) {
+        cout << name << ": reverse decoded " << decoded << " instead of " << reverse << endl;
+        mismatches++;
+    }
+    for (size_t i = 0; i < sequence.size(); i++) {
+        if (arena.get_base(span, i) != sequence[i] || arena.view(span, true)[i] != reverse[i]) {
+            cout << name << ": wrong base at " << i << endl;
+            mismatches++;
+            break;
+        }
+    }
+    for (size_t offset : {size_t(0), min(size_t(1), sequence.size()), sequence.size() / 3}) {
+        if (arena.view(span, false).substr(offset, 7).str() != sequence.substr(offset, 7)
+                || arena.view(span, true).substr(offset, 7).str() != reverse.substr(offset, 7)) {
+            cout << name << ": wrong sub-view at " << offset << endl;
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+/// Appends sequences mixing ACGT, N runs, IUPAC codes and soft-masked
+/// stretches, checks that they and copies of their pieces round-trip, and
+/// that runs of N or lowercase take one entry each
+int main() {
+    int mismatches = 0;
+    vector<string> sequences = {
+        "GATTACA",
+        "gattaca",
+        "",
+        string(10000, 'N'),
+        "ACGTNNNNacgtnnnnRYKMrykmACGT",
+        "NNNNnnnnNNNN",
+        "A-*.a",
+        string(3000, 'a') + "NNN" + string(3000, 'T') + string(2000, 'c'),
+        "GATTACA"
+    };
+
+    SequenceArena arena;
+    vector<SequenceSpan> spans;
+    for (const auto& sequence : sequences) spans.push_back(arena.append(sequence));
+    for (size_t i = 0; i < sequences.size(); i++) {
+        mismatches += check_span(arena, spans[i], sequences[i], "Sequence " + to_string(i));
+    }
+
+    /// Pieces copied into another arena start and end inside runs
+    SequenceArena copy;
+    for (size_t i = 0; i < sequences.size(); i++) {
+        for (size_t offset : {size_t(0), size_t(2), sequences[i].size() / 2}) {
+            SequenceSpan piece;
+            piece.offset = spans[i].offset + min(offset, spans[i].length);
+            piece.length = min(spans[i].length - (piece.offset - spans[i].offset), size_t(3003));
+            mismatches += check_span(copy, copy.append(arena, piece),
+                sequences[i].substr(piece.offset - spans[i].offset, piece.length),
+                "Copy of sequence " + to_string(i) + " from " + to_string(offset));
+        }
+    }
+
+    /// Runs, not bases, are stored: the 10000 Ns and the long soft-masked
+    /// stretches only take a handful of entries
+    SequenceArena runs;
+    runs.append(string(10000, 'N'));
+    runs.append(string(10000, 'n'));
+    runs.append(string(10000, 'a') + string(10000, 'c'));
+    for (const auto& part : runs.memory_usage().parts) {
+        if ((part.name == "exceptions" || part.name == "lowercase") && part.bytes > 64) {
+            cout << "Runs: " << part.name << " take " << part.bytes << " bytes" << endl;
+            mismatches++;
+        }
+    }
+
+    cout << (mismatches ? "Failure" : "Success") << endl;
+    return mismatches != 0;
+}
@@ -0,0 +1,137 @@
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "../../src/BidirectedGraph.hpp"
+#include "../../src/BidirectedGraphBuilder.hpp"
+#include "../../src/ConcurrentGraphBuilder.hpp"
+
+using namespace std;
+
+/// Collects the neighbors of a node-side.
+unordered_set<handle_t> neighbors(const HandleGraph& g, const handle_t& handle, bool go_left) {
+    unordered_set<handle_t> found;
+    g.follow_edges(handle, go_left, [&](const handle_t& next) {
+        found.insert(next);
+    });
+    return found;
+}
+
+/// Compares a built graph against the graph loaded from JSON. Returns the
+/// number of mismatches.
+int compare(const BidirectedGraph& g, const BidirectedGraph& built, const string& name) {
+    int mismatches = 0;
+    if (built.get_node_count() != g.get_node_count() || built.get_edge_count() != g.get_edge_count()) {
+        cout << name << ": node or edge count mismatch" << endl;
+        mismatches++;
+    }
+
+    g.for_each_handle([&](const handle_t& handle) {
+        nid_t id = g.get_id(handle);
+        if (!built.has_node(id)) {
+            cout << name << ": node " << id << " missing" << endl;
+            mismatches++;
+            return;
+        }
+        for (bool is_reverse : {false, true}) {
+            handle_t oriented = g.get_handle(id, is_reverse);
+            for (bool go_left : {false, true}) {
+                if (neighbors(built, oriented, go_left) != neighbors(g, oriented, go_left)) {
+                    cout << name << ": node " << id << (is_reverse ? "r" : "")
+                        << " mismatch going " << (go_left ? "left" : "right") << endl;
+                    mismatches++;
+                }
+            }
+            if (built.get_sequence(oriented) != g.get_sequence(oriented)) {
+                cout << name << ": node " << id << (is_reverse ? "r" : "") << " sequence mismatch" << endl;
+                mismatches++;
+            }
+        }
+    });
+    return mismatches;
+}
+
+/// Every edge of the graph, once from each of its ends
+vector<pair<handle_t, handle_t>> get_edges(const BidirectedGraph& g) {
+    vector<pair<handle_t, handle_t>> edges;
+    g.for_each_handle([&](const handle_t& handle) {
+        for (bool is_reverse : {false, true}) {
+            handle_t side = is_reverse ? g.flip(handle) : handle;
+            g.follow_edges(side, false, [&](const handle_t& next) {
+                edges.emplace_back(side, next);
+            });
+        }
+    });
+    return edges;
+}
+
+int main(int argc, char* argv[]) {
+    string filename = argv[argc - 1];
+    ifstream json_file(filename, ifstream::binary);
+
+    BidirectedGraph g;
+    if (!g.deserialize(json_file)) return 1;
+    vector<pair<handle_t, handle_t>> edges = get_edges(g);
+    int mismatches = 0;
+
+    /// Edges are added from both ends and before their nodes, with one to a
+    /// missing node that should be dropped
+    BidirectedGraph built;
+    BidirectedGraphBuilder builder(built);
+    builder.reserve(g.get_node_count(), edges.size());
+    for (const auto& [left, right] : edges) builder.add_edge(left, right);
+    builder.add_edge(g.get_handle(g.max_node_id() + 1), g.get_handle(g.min_node_id()));
+    g.for_each_handle([&](const handle_t& handle) {
+        builder.add_node(g.get_id(handle), g.get_sequence(handle));
+    });
+    builder.finalize();
+    mismatches += compare(g, built, "Builder");
+
+    /// A second round into a graph that already has half the nodes goes
+    /// through the regular graph API
+    BidirectedGraph merged;
+    bool is_first_half = true;
+    g.for_each_handle([&](const handle_t& handle) {
+        if (is_first_half) merged.create_handle(g.get_sequence(handle), g.get_id(handle));
+        is_first_half = !is_first_half;
+    });
+    BidirectedGraphBuilder merger(merged);
+    g.for_each_handle([&](const handle_t& handle) {
+        if (!merged.has_node(g.get_id(handle))) merger.add_node(g.get_id(handle), g.get_sequence(handle));
+    });
+    for (const auto& [left, right] : edges) merger.add_edge(left, right);
+    merger.finalize();
+    mismatches += compare(g, merged, "Builder into a non-empty graph");
+
+    /// Four threads each add every fourth edge and then every fourth node,
+    /// into the default number of shards and into just two
+    vector<nid_t> ids;
+    g.for_each_handle([&](const handle_t& handle) {
+        ids.push_back(g.get_id(handle));
+    });
+    for (size_t shard_count : {0, 2}) {
+        BidirectedGraph concurrent;
+        ConcurrentGraphBuilder concurrent_builder(concurrent, shard_count);
+        vector<thread> threads;
+        for (size_t t = 0; t < 4; t++) {
+            threads.emplace_back([&, t]() {
+                for (size_t i = t; i < edges.size(); i += 4) {
+                    concurrent_builder.add_edge(edges[i].first, edges[i].second);
+                }
+                for (size_t i = t; i < ids.size(); i += 4) {
+                    concurrent_builder.add_node(ids[i], g.get_sequence(g.get_handle(ids[i])));
+                }
+            });
+        }
+        for (auto& worker : threads) worker.join();
+        concurrent_builder.finalize();
+        mismatches += compare(g, concurrent, "Concurrent builder with " + to_string(shard_count) + " shards");
+    }
+
+    cout << (mismatches ? "Failure" : "Success") << endl;
+    return mismatches != 0;
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../../../src/BidirectedGraph.hpp"
+#include "../../../src/ThreadPool.hpp"
+#include "../../../src/algorithms/bundle.hpp"
+#include "../../../src/algorithms/find_bundles.hpp"
+
+using namespace std;
+
+/// Writes node-sides sorted by node ID, with + for forward and - for reverse,
+/// flipping every node-side if asked
+string side_to_str(Bundle* bundle, bool is_left, bool is_flipped) {
+    vector<uint64_t> side;
+    for (const auto& handle : bundle->get_bundleside(is_left)) {
+        side.push_back(as_integer(handle) ^ (is_flipped ? 1 : 0));
+    }
+    sort(side.begin(), side.end());
+    string out;
+    for (size_t i = 0; i < side.size(); i++) {
+        out += (i ? "," : "") + to_string(side[i] >> 1) + (side[i] & 1 ? "-" : "+");
+    }
+    return out;
+}
+
+/// Writes a bundle as <left>|<right>, in whichever of its two directions
+/// comes first, followed by /B, /T and /C for balanced, trivial and cyclic
+/// bundles
+string bundle_to_str(Bundle* bundle) {
+    string out = min(side_to_str(bundle, true, false) + "|" + side_to_str(bundle, false, false),
+            side_to_str(bundle, false, true) + "|" + side_to_str(bundle, true, true));
+    string flags = string(bundle->is_balanced() ? "B" : "") + (bundle->is_trivial() ? "T" : "")
+        + (bundle->is_cyclic() ? "C" : "");
+    return flags.empty() ? out : out + "/" + flags;
+}
+
+/// Finds the bundles of g with the serial sweep and with the parallel one,
+/// which must report the same bundles in the same order. Returns the serial
+/// bundles as strings, and counts a mismatch if the two differ.
+vector<string> find_both_ways(const BidirectedGraph& g, bool is_balanced,
+        const string& name, int& mismatches) {
+    vector<string> found[2];
+    for (bool parallel : {false, true}) {
+        for (auto& bundle : find_bundles(g, is_balanced, parallel)) {
+            found[parallel].push_back(bundle_to_str(bundle));
+            BundlePool::get_instance()->return_bundle(bundle);
+        }
+    }
+    if (found[0] != found[1]) {
+        cout << name << (is_balanced ? " balanced" : " all")
+            << ": parallel search found " << found[1].size() << " bundles, serial "
+            << found[0].size() << ", or in another order" << endl;
+        mismatches++;
+    }
+    return found[0];
+}
+
+/// Builds a graph large enough to span several blocks of the parallel
+/// search: a chain of bubbles, some with a flipped branch, plus random edges
+/// that tie far apart parts of the chain together and make some bundles
+/// unbalanced or cyclic
+void build_large_graph(BidirectedGraph& g, size_t bubble_count) {
+    mt19937 random(7);
+    vector<handle_t> chain;
+    handle_t prev = g.create_handle("A");
+    chain.push_back(prev);
+    for (size_t i = 0; i < bubble_count; i++) {
+        handle_t top = g.create_handle("C");
+        handle_t bottom = g.create_handle("G");
+        handle_t next = g.create_handle("T");
+        bool is_flipped = random() % 4 == 0;
+        g.create_edge(prev, top);
+        g.create_edge(top, next);
+        g.create_edge(prev, is_flipped ? g.flip(bottom) : bottom);
+        g.create_edge(is_flipped ? g.flip(bottom) : bottom, next);
+        chain.insert(chain.end(), {top, bottom, next});
+        prev = next;
+    }
+    for (size_t i = 0; i < bubble_count / 8; i++) {
+        handle_t from = chain[random() % chain.size()];
+        handle_t to = i % 16 == 0 ? from : chain[random() % chain.size()];
+        g.create_edge(random() % 2 ? g.flip(from) : from, random() % 2 ? g.flip(to) : to);
+    }
+}
+
+/// Finds the bundles of every graph listed in the expected file, one search
+/// per line as "<graph> <balanced|all> <bundle>...", and compares them
+/// against the bundles recorded there. The order the bundles are found in
+/// doesn't matter. Every search is also run in parallel, on those graphs and
+/// on a generated one, and checked against the serial result.
+int main(int argc, char* argv[]) {
+    ThreadPool::get_instance().set_thread_count(4);
+    string filename = argv[argc - 1];
+    ifstream expected_file(filename);
+    string directory = filename.substr(0, filename.find_last_of('/') + 1);
+    int mismatches = 0;
+
+    string line;
+    while (getline(expected_file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        istringstream fields(line);
+        string graph_file;
+        string mode;
+        fields >> graph_file >> mode;
+        set<string> expected;
+        for (string bundle; fields >> bundle;) expected.insert(bundle);
+
+        BidirectedGraph g;
+        ifstream json_file(directory + graph_file, ifstream::binary);
+        if (!g.deserialize(json_file)) {
+            cout << graph_file << ": couldn't be loaded" << endl;
+            mismatches++;
+            continue;
+        }
+
+        vector<string> serial = find_both_ways(g, mode == "balanced", graph_file, mismatches);
+        set<string> found(serial.begin(), serial.end());
+        if (found != expected) {
+            cout << graph_file << " " << mode << ": got";
+            for (const auto& bundle : found) cout << " " << bundle;
+            cout << endl;
+            mismatches++;
+        }
+    }
+
+    BidirectedGraph large;
+    build_large_graph(large, 2000);
+    for (bool is_balanced : {false, true}) {
+        find_both_ways(large, is_balanced, "generated graph", mismatches);
+    }
+
+    cout << (mismatches ? "Failure" : "Success") << endl;
+    return mismatches != 0;
+}
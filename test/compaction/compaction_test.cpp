@@ -0,0 +1,158 @@
+#include <iostream>
+#include <string>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "../../src/BidirectedGraph.hpp"
+
+using namespace std;
+
+/// Node order, sequences and edges of a graph
+struct Contents {
+    vector<nid_t> order;
+    map<nid_t, string> sequences;
+    set<pair<handle_t, handle_t>> edges;
+
+    bool operator==(const Contents& other) const {
+        return order == other.order && sequences == other.sequences && edges == other.edges;
+    }
+};
+
+Contents get_contents(const BidirectedGraph& g) {
+    Contents contents;
+    g.for_each_handle([&](const handle_t& handle) {
+        contents.order.push_back(g.get_id(handle));
+        contents.sequences[g.get_id(handle)] = g.get_sequence(handle);
+        for (bool is_reverse : {false, true}) {
+            handle_t side = is_reverse ? g.flip(handle) : handle;
+            g.follow_edges(side, false, [&](const handle_t& next) {
+                contents.edges.emplace(side, next);
+            });
+        }
+    });
+    return contents;
+}
+
+/// Checks that no edge leads to a destroyed node and that the counts agree
+/// with what is left. Returns the number of mismatches.
+int check_counts(const BidirectedGraph& g, size_t node_count, const string& name) {
+    int mismatches = 0;
+    size_t entries = 0;
+    size_t inversions = 0;
+    g.for_each_handle([&](const handle_t& handle) {
+        for (bool is_reverse : {false, true}) {
+            handle_t side = is_reverse ? g.flip(handle) : handle;
+            g.follow_edges(side, false, [&](const handle_t& next) {
+                if (!g.has_node(g.get_id(next))) {
+                    cout << name << ": edge to destroyed node " << g.get_id(next) << endl;
+                    mismatches++;
+                }
+                entries++;
+                if (next == g.flip(side)) inversions++;
+            });
+        }
+    });
+
+    size_t sides = 0;
+    for (size_t count : g.stats().degree_histogram) sides += count;
+    if (g.get_node_count() != node_count || sides != 2 * node_count
+            || g.get_edge_count() != (entries + inversions) / 2) {
+        cout << name << ": counts mismatch" << endl;
+        mismatches++;
+    }
+    return mismatches;
+}
+
+/// Builds a chain of nodes first, first + step, ..., each also joined to a
+/// head and a tail node, destroys most of it and walks the graph while
+/// creating nodes.
+/// Returns the number of mismatches.
+int check(nid_t first, nid_t step, nid_t head_id, nid_t tail_id, const string& name) {
+    const size_t count = 5000;
+    int mismatches = 0;
+    BidirectedGraph g;
+    handle_t head = g.create_handle("GATTACA", head_id);
+    vector<handle_t> chain;
+    for (size_t i = 0; i < count; i++) {
+        chain.push_back(g.create_handle(string(1 + i % 5, 'C'), first + step * static_cast<nid_t>(i)));
+        g.create_edge(head, g.flip(chain.back()));
+        if (i > 0) g.create_edge(chain[i - 1], chain[i]);
+    }
+    handle_t tail = g.create_handle("TACA", tail_id);
+    for (const auto& handle : chain) g.create_edge(handle, tail);
+    g.create_edge(head, g.flip(head));
+
+    /// Destroyed nodes are gone at once, though their slots stay behind
+    size_t node_count = g.get_node_count();
+    for (size_t i = 0; i < count; i++) {
+        if (i % 10 == 0) continue;
+        nid_t id = first + step * static_cast<nid_t>(i);
+        g.destroy_handle(g.get_handle(id));
+        node_count--;
+        if (g.has_node(id)) {
+            cout << name << ": node " << id << " still there" << endl;
+            mismatches++;
+        }
+    }
+    mismatches += check_counts(g, node_count, name);
+    Contents before = get_contents(g);
+    size_t garbage_bytes = g.memory_usage().total();
+
+    /// There is now enough garbage for create_handle to compact, but not
+    /// while a walk is running: both walks still see everything once. Nodes
+    /// are only created past the first few, whose slots compaction wouldn't
+    /// move.
+    vector<nid_t> created;
+    vector<nid_t> seen;
+    g.for_each_handle([&](const handle_t& handle) {
+        if (!before.sequences.count(g.get_id(handle))) return;
+        seen.push_back(g.get_id(handle));
+        if (seen.size() > 10) created.push_back(g.get_id(g.create_handle("T")));
+    });
+    if (seen != before.order) {
+        cout << name << ": node walk missed nodes while creating them" << endl;
+        mismatches++;
+    }
+    size_t neighbor_count = 0;
+    g.follow_edges(tail, true, [&](const handle_t&) {
+        neighbor_count++;
+        created.push_back(g.get_id(g.create_handle("T")));
+    });
+    if (neighbor_count != g.get_degree(tail, true)) {
+        cout << name << ": edge walk missed neighbors while creating nodes" << endl;
+        mismatches++;
+    }
+
+    /// Outside of walks the next new node reclaims the garbage, keeping the
+    /// IDs and order of the nodes left
+    for (const auto& id : created) g.destroy_handle(g.get_handle(id));
+    nid_t last_id = g.get_id(g.create_handle("G"));
+    if (g.memory_usage().total() >= garbage_bytes) {
+        cout << name << ": garbage wasn't reclaimed" << endl;
+        mismatches++;
+    }
+    g.destroy_handle(g.get_handle(last_id));
+    if (!(get_contents(g) == before)) {
+        cout << name << ": automatic compaction changed the graph" << endl;
+        mismatches++;
+    }
+    mismatches += check_counts(g, node_count, name);
+
+    g.compact();
+    if (!(get_contents(g) == before)) {
+        cout << name << ": compaction changed the graph" << endl;
+        mismatches++;
+    }
+    return mismatches;
+}
+
+/// Destroys nodes of graphs with dense and with hashed IDs and checks them
+/// before and after compaction
+int main() {
+    int mismatches = check(2, 1, 1, 5002, "Dense");
+    mismatches += check(1, 1000, 1000000000, 2000000000, "Hashed");
+    cout << (mismatches ? "Failure" : "Success") << endl;
+    return mismatches != 0;
+}
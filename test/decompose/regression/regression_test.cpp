@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../../src/BidirectedGraph.hpp"
+#include "../../../src/algorithms/bundle_index.hpp"
+#include "../../../src/algorithms/decompose.hpp"
+#include "../../../src/algorithms/find_bundles.hpp"
+
+using namespace std;
+
+/// Writes a decomposition tree so it doesn't depend on the order of the
+/// reductions: sources by ID and epsilon nodes as E, splits with their
+/// children sorted and chains in the smaller of their two directions. Self
+/// cycles add an o and self-inversions an i each.
+string canonical(const DecompositionNode* node) {
+    string out;
+    if (node->type == Source) {
+        out = "S" + to_string(node->nid);
+    } else if (node->type == Epsilon) {
+        out = "E";
+    } else {
+        vector<string> children;
+        if (node->type == Split) {
+            for (const auto& child : node->children) children.push_back(canonical(child));
+            sort(children.begin(), children.end());
+        } else {
+            for (auto child = node->child_head; child != nullptr; child = child->sibling) {
+                children.push_back(canonical(child));
+            }
+        }
+        string forward;
+        string backward;
+        for (size_t i = 0; i < children.size(); i++) {
+            forward += (i ? "," : "") + children[i];
+            backward += (i ? "," : "") + children[children.size() - 1 - i];
+        }
+        out = (node->type == Split ? "P(" : "C(") + min(forward, backward) + ")";
+    }
+    if (node->scycle) out += "o";
+    out += string(node->sinv[0] + node->sinv[1], 'i');
+    return out;
+}
+
+/// One side of a bundle as sorted integers, with every node-side flipped
+/// if asked
+vector<uint64_t> get_side(Bundle* bundle, bool is_left, bool is_flipped) {
+    vector<uint64_t> side;
+    for (const auto& handle : bundle->get_bundleside(is_left)) {
+        side.push_back(as_integer(handle) ^ (is_flipped ? 1 : 0));
+    }
+    sort(side.begin(), side.end());
+    return side;
+}
+
+/// Compares the bundles of the index against the bundles found from
+/// scratch. Returns the number of mismatches.
+int check_index(const BidirectedGraph& g, const BundleIndex& index, const string& name) {
+    vector<Bundle*> found = find_bundles(g, false);
+    unordered_map<handle_t, Bundle*> expected;
+    for (auto& bundle : found) {
+        for (const auto& handle : bundle->get_left()) expected[handle] = bundle;
+        for (const auto& handle : bundle->get_right()) expected[g.flip(handle)] = bundle;
+    }
+
+    int mismatches = 0;
+    map<Bundle*, Bundle*> matches;
+    if (index.get_map().size() != expected.size()) mismatches++;
+    for (const auto& [key, bundle] : index.get_map()) {
+        auto it = expected.find(key);
+        if (it == expected.end() || matches.emplace(it->second, bundle).first->second != bundle) {
+            mismatches++;
+            continue;
+        }
+        /// Either bundle may be flipped
+        Bundle* other = it->second;
+        vector<uint64_t> left = get_side(bundle, true, false);
+        vector<uint64_t> right = get_side(bundle, false, false);
+        bool is_same = (left == get_side(other, true, false) && right == get_side(other, false, false))
+            || (left == get_side(other, false, true) && right == get_side(other, true, true));
+        if (!is_same
+                || bundle->is_trivial() != other->is_trivial()
+                || bundle->is_cyclic() != other->is_cyclic()
+                || bundle->is_balanced() != other->is_balanced()) {
+            mismatches++;
+        }
+    }
+    for (auto& bundle : found) BundlePool::get_instance()->return_bundle(bundle);
+    if (mismatches) cout << name << ": bundle index doesn't match find_bundles" << endl;
+    return mismatches;
+}
+
+/// Removes the edges of the graph through a bundle index one at a time and
+/// puts them back in the opposite order, checking the bundles after each
+/// edit. Returns the number of edits with mismatches.
+int check_edits(BidirectedGraph& g, const string& name) {
+    vector<edge_t> edges;
+    g.for_each_edge([&](const edge_t& edge) {
+        edges.push_back(edge);
+    });
+    BundleIndex index(&g);
+    index.build();
+    int mismatches = check_index(g, index, name + " built") != 0;
+    for (size_t i = 0; i < edges.size(); i++) {
+        index.destroy_edge(edges[i].first, edges[i].second);
+        mismatches += check_index(g, index, name + " without " + to_string(i + 1) + " edges") != 0;
+    }
+    for (size_t i = edges.size(); i-- > 0;) {
+        index.create_edge(edges[i].first, edges[i].second);
+        mismatches += check_index(g, index, name + " with " + to_string(edges.size() - i) + " edges") != 0;
+    }
+    return mismatches;
+}
+
+/// Decomposes every graph listed in the expected file, one per line as
+/// "<graph> <nodes left> <tree>" with - for no single root, and compares the
+/// trees against the ones recorded there. The bundles of each graph are also
+/// kept up to date while its edges are removed and put back.
+int main(int argc, char* argv[]) {
+    string filename = argv[argc - 1];
+    ifstream expected_file(filename);
+    string directory = filename.substr(0, filename.find_last_of('/') + 1);
+    int mismatches = 0;
+
+    string line;
+    while (getline(expected_file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        istringstream fields(line);
+        string graph_file;
+        size_t expected_count;
+        string expected_tree;
+        fields >> graph_file >> expected_count >> expected_tree;
+
+        BidirectedGraph g;
+        ifstream json_file(directory + graph_file, ifstream::binary);
+        if (!g.deserialize(json_file)) {
+            cout << graph_file << ": couldn't be loaded" << endl;
+            mismatches++;
+            continue;
+        }
+        mismatches += check_edits(g, graph_file);
+
+        /// The builder prints every reduction it makes
+        BidirectedGraph reduced;
+        ifstream reduced_file(directory + graph_file, ifstream::binary);
+        reduced.deserialize(reduced_file);
+        stringstream log;
+        streambuf* out = cout.rdbuf(log.rdbuf());
+        DecompositionTreeBuilder builder(&reduced);
+        DecompositionNode* root = builder.construct_tree();
+        cout.rdbuf(out);
+
+        string tree = root == nullptr ? "-" : canonical(root);
+        if (reduced.get_node_count() != expected_count || tree != expected_tree) {
+            cout << graph_file << ": expected " << expected_count << " " << expected_tree
+                << ", got " << reduced.get_node_count() << " " << tree << endl;
+            mismatches++;
+        }
+    }
+
+    cout << (mismatches ? "Failure" : "Success") << endl;
+    return mismatches != 0;
+}
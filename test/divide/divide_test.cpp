@@ -0,0 +1,162 @@
+#include <iostream>
+#include <string>
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "../../src/BidirectedGraph.hpp"
+
+using namespace std;
+
+/// An edge as (from ID, from reverse, to ID, to reverse), written in the
+/// smaller of its two orientations
+using id_edge_t = tuple<nid_t, bool, nid_t, bool>;
+
+id_edge_t get_id_edge(const BidirectedGraph& g, const handle_t& left, const handle_t& right) {
+    id_edge_t edge(g.get_id(left), g.get_is_reverse(left), g.get_id(right), g.get_is_reverse(right));
+    id_edge_t complement(g.get_id(right), !g.get_is_reverse(right), g.get_id(left), !g.get_is_reverse(left));
+    return min(edge, complement);
+}
+
+set<id_edge_t> get_edges(const BidirectedGraph& g) {
+    set<id_edge_t> edges;
+    g.for_each_handle([&](const handle_t& handle) {
+        for (bool is_reverse : {false, true}) {
+            handle_t side = is_reverse ? g.flip(handle) : handle;
+            g.follow_edges(side, false, [&](const handle_t& next) {
+                edges.insert(get_id_edge(g, side, next));
+            });
+        }
+    });
+    return edges;
+}
+
+/// Builds a node with edges on both of its sides, including a loop and a
+/// self-inversion on each side, and divides it in the given orientation.
+/// Returns the number of mismatches.
+int check_divide(bool is_reverse, const string& name) {
+    int mismatches = 0;
+    BidirectedGraph g;
+    handle_t a = g.create_handle("AC");
+    handle_t node = g.create_handle("GATTACA");
+    handle_t b = g.create_handle("TT");
+    handle_t c = g.create_handle("G");
+    vector<pair<handle_t, handle_t>> edges = {
+        {a, node}, {g.flip(c), node}, {node, b}, {node, g.flip(c)},
+        {node, node}, {node, g.flip(node)}, {g.flip(node), node}
+    };
+    for (const auto& [left, right] : edges) g.create_edge(left, right);
+    size_t edge_count = g.get_edge_count();
+
+    /// Out of range, zero and repeated offsets are skipped
+    handle_t divided = is_reverse ? g.flip(node) : node;
+    string sequence = g.get_sequence(divided);
+    vector<handle_t> pieces = g.divide_handle(divided, {0, 2, 2, 5, 7, 20});
+
+    vector<string> expected_sequences = {sequence.substr(0, 2), sequence.substr(2, 3), sequence.substr(5)};
+    vector<string> sequences;
+    for (const auto& piece : pieces) sequences.push_back(g.get_sequence(piece));
+    if (sequences != expected_sequences) {
+        cout << name << ": piece sequence mismatch" << endl;
+        mismatches++;
+    }
+    if (pieces.size() != 3) return mismatches + 1;
+
+    /// Pieces are returned in the orientation divided; in the node's forward
+    /// orientation the first one keeps its ID
+    vector<handle_t> forward = pieces;
+    if (is_reverse) {
+        forward.assign(pieces.rbegin(), pieces.rend());
+        for (auto& piece : forward) piece = g.flip(piece);
+    }
+    for (size_t i = 0; i < forward.size(); i++) {
+        if (g.get_is_reverse(forward[i]) || (i == 0) != (g.get_id(forward[i]) == g.get_id(node))) {
+            cout << name << ": piece " << i << " has the wrong ID or orientation" << endl;
+            mismatches++;
+        }
+    }
+
+    /// Edges into the node's left side now reach the first piece and those
+    /// on its right side leave the last, with the pieces chained in between
+    auto leaving = [&](const handle_t& side) {
+        if (g.get_id(side) != g.get_id(node)) return side;
+        return g.get_is_reverse(side) ? g.flip(forward.front()) : forward.back();
+    };
+    set<id_edge_t> expected;
+    for (const auto& [left, right] : edges) {
+        expected.insert(get_id_edge(g, leaving(left), g.flip(leaving(g.flip(right)))));
+    }
+    for (size_t i = 1; i < forward.size(); i++) expected.insert(get_id_edge(g, forward[i - 1], forward[i]));
+    if (get_edges(g) != expected || g.get_edge_count() != edge_count + forward.size() - 1) {
+        cout << name << ": edge mismatch" << endl;
+        mismatches++;
+    }
+    if (g.get_node_count() != 6 || g.get_total_length() != 12) {
+        cout << name << ": node count or length mismatch" << endl;
+        mismatches++;
+    }
+    return mismatches;
+}
+
+/// Splits every long node of a cycle and checks that each one became a
+/// path of short pieces. Returns the number of mismatches.
+int check_divide_handles(const string& name) {
+    const size_t max_length = 3;
+    int mismatches = 0;
+    BidirectedGraph g;
+    vector<string> sequences = {"A", "GATTACA", "CAT", "TTTTGGGGCCCCAAAA", "GC"};
+    vector<handle_t> chain;
+    for (const auto& sequence : sequences) {
+        chain.push_back(g.create_handle(sequence));
+        if (chain.size() > 1) g.create_edge(chain[chain.size() - 2], chain.back());
+    }
+    g.create_edge(chain.back(), chain.front());
+
+    g.divide_handles(max_length);
+
+    /// Walk the cycle forward from the first node, which is short
+    string walked;
+    size_t node_count = 0;
+    handle_t handle = chain.front();
+    while (true) {
+        walked += g.get_sequence(handle);
+        node_count++;
+        if (g.get_length(handle) > max_length) {
+            cout << name << ": node " << g.get_id(handle) << " is too long" << endl;
+            mismatches++;
+        }
+        vector<handle_t> next;
+        g.follow_edges(handle, false, [&](const handle_t& found) {
+            next.push_back(found);
+        });
+        if (next.size() != 1 || node_count > g.get_node_count()) {
+            cout << name << ": the chain branches" << endl;
+            return mismatches + 1;
+        }
+        if (g.get_id(next.front()) == g.get_id(chain.front())) break;
+        handle = next.front();
+    }
+
+    string joined;
+    for (const auto& sequence : sequences) joined += sequence;
+    if (walked != joined || node_count != g.get_node_count()) {
+        cout << name << ": chain mismatch" << endl;
+        mismatches++;
+    }
+    for (size_t i = 0; i < chain.size(); i++) {
+        if (!g.has_node(g.get_id(chain[i])) || g.get_sequence(chain[i]) != sequences[i].substr(0, max_length)) {
+            cout << name << ": node " << g.get_id(chain[i]) << " lost its first piece" << endl;
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+int main() {
+    int mismatches = check_divide(false, "Forward division");
+    mismatches += check_divide(true, "Reverse division");
+    mismatches += check_divide_handles("Dividing long handles");
+    cout << (mismatches ? "Failure" : "Success") << endl;
+    return mismatches != 0;
+}
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <unordered_set>
+#include <atomic>
+
+#include "../../src/BidirectedGraph.hpp"
+#include "../../src/FrozenBidirectedGraph.hpp"
+#include "../../src/MappedBidirectedGraph.hpp"
+
+using namespace std;
+
+/// Collects the neighbors of a node-side.
+unordered_set<handle_t> neighbors(const HandleGraph& g, const handle_t& handle, bool go_left) {
+    unordered_set<handle_t> found;
+    g.follow_edges(handle, go_left, [&](const handle_t& next) {
+        found.insert(next);
+    });
+    return found;
+}
+
+/// Compares a read-only copy against the graph it was made from. Returns
+/// the number of mismatches.
+int compare(const BidirectedGraph& g, const HandleGraph& copy, const string& name) {
+    int mismatches = 0;
+    if (copy.get_node_count() != g.get_node_count()) {
+        cout << name << ": node count mismatch" << endl;
+        mismatches++;
+    }
+
+    g.for_each_handle([&](const handle_t& handle) {
+        for (bool is_reverse : {false, true}) {
+            handle_t oriented = is_reverse ? g.flip(handle) : handle;
+            for (bool go_left : {false, true}) {
+                auto expected = neighbors(g, oriented, go_left);
+                auto found = neighbors(copy, oriented, go_left);
+                if (expected != found || copy.get_degree(oriented, go_left) != expected.size()) {
+                    cout << name << ": node " << g.get_id(handle) << (is_reverse ? "r" : "")
+                        << " mismatch going " << (go_left ? "left" : "right") << endl;
+                    mismatches++;
+                }
+                for (const auto& next : expected) {
+                    if (!go_left && !copy.has_edge(oriented, next)) mismatches++;
+                }
+            }
+            if (copy.get_sequence(oriented) != g.get_sequence(oriented)) {
+                cout << name << ": node " << g.get_id(handle) << (is_reverse ? "r" : "") << " sequence mismatch" << endl;
+                mismatches++;
+            }
+        }
+    });
+
+    /// A parallel walk visits every node once
+    atomic<size_t> visited(0);
+    copy.for_each_handle([&](const handle_t& handle) {
+        if (g.has_node(copy.get_id(handle))) visited++;
+    }, true);
+    if (visited != g.get_node_count()) {
+        cout << name << ": parallel walk mismatch" << endl;
+        mismatches++;
+    }
+
+    cout << name << " edges: " << copy.get_edge_count() << endl;
+    return mismatches;
+}
+
+int main(int argc, char* argv[]) {
+    string filename = argv[argc - 1];
+    ifstream json_file(filename, ifstream::binary);
+
+    BidirectedGraph g;
+    if (!g.deserialize(json_file)) return 1;
+    FrozenBidirectedGraph frozen(g);
+    int mismatches = compare(g, frozen, "Frozen");
+
+    /// Round trip through the binary format and serve it from the mapping
+    string binary_filename = "frozen_test.bdg";
+    ofstream binary_file(binary_filename, ofstream::binary);
+    g.serialize_binary(binary_file);
+    binary_file.close();
+    MappedBidirectedGraph mapped;
+    if (!mapped.open(binary_filename)) return 1;
+    mismatches += compare(g, mapped, "Mapped");
+
+    cout << (mismatches ? "Failure" : "Success") << endl;
+    return mismatches != 0;
+}
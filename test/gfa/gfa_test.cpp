@@ -0,0 +1,143 @@
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "../../src/BidirectedGraph.hpp"
+
+using namespace std;
+
+/// An edge as (from ID, from reverse, to ID, to reverse), written in the
+/// smaller of its two orientations
+using id_edge_t = tuple<nid_t, bool, nid_t, bool>;
+
+/// Node lengths, sequences and edges of a graph, by ID
+struct Contents {
+    map<nid_t, size_t> lengths;
+    map<nid_t, string> sequences;
+    set<id_edge_t> edges;
+
+    bool operator==(const Contents& other) const {
+        return lengths == other.lengths && sequences == other.sequences && edges == other.edges;
+    }
+};
+
+Contents get_contents(const BidirectedGraph& g) {
+    Contents contents;
+    g.for_each_handle([&](const handle_t& handle) {
+        contents.lengths[g.get_id(handle)] = g.get_length(handle);
+        if (g.has_sequences()) contents.sequences[g.get_id(handle)] = g.get_sequence(handle);
+        for (bool is_reverse : {false, true}) {
+            handle_t side = is_reverse ? g.flip(handle) : handle;
+            g.follow_edges(side, false, [&](const handle_t& next) {
+                id_edge_t edge(g.get_id(side), g.get_is_reverse(side), g.get_id(next), g.get_is_reverse(next));
+                id_edge_t complement(g.get_id(next), !g.get_is_reverse(next), g.get_id(side), !g.get_is_reverse(side));
+                contents.edges.insert(min(edge, complement));
+            });
+        }
+    });
+    return contents;
+}
+
+/// Loads a GFA file into a new graph. Returns false if it can't be parsed.
+bool load(const string& filename, BidirectedGraph& g, LoadMode mode = LoadMode::FULL) {
+    ifstream gfa_file(filename);
+    return g.deserialize_gfa(gfa_file, mode);
+}
+
+/// Writes the graph as GFA and loads it back, checking that the contents
+/// and the paths survive. Returns the number of mismatches.
+int check_round_trip(BidirectedGraph& g, LoadMode mode, const string& name) {
+    int mismatches = 0;
+    string filename = "gfa_test.gfa";
+    {
+        ofstream out_file(filename);
+        if (!g.serialize_gfa(out_file)) {
+            cout << name << ": write failed" << endl;
+            return 1;
+        }
+    }
+
+    BidirectedGraph loaded;
+    if (!load(filename, loaded, mode)) {
+        cout << name << ": written GFA doesn't parse" << endl;
+        return 1;
+    }
+    if (!(get_contents(loaded) == get_contents(g)) || loaded.get_edge_count() != g.get_edge_count()) {
+        cout << name << ": contents mismatch" << endl;
+        mismatches++;
+    }
+
+    ifstream written(filename);
+    string line;
+    bool has_path = false;
+    while (getline(written, line)) has_path |= line == "P\tx\t1+,2-,3+\t*";
+    if (!has_path) {
+        cout << name << ": path line lost" << endl;
+        mismatches++;
+    }
+    return mismatches;
+}
+
+/// Loads GFA text that should be rejected and checks that nothing was
+/// added. Returns the number of mismatches.
+int check_rejected(const string& text, const string& name) {
+    string filename = "gfa_test.gfa";
+    {
+        ofstream out_file(filename);
+        out_file << text;
+    }
+    BidirectedGraph g;
+    if (load(filename, g) || g.get_node_count() != 0 || g.get_edge_count() != 0) {
+        cout << name << ": wasn't rejected" << endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    string filename = argv[argc - 1];
+    int mismatches = 0;
+
+    /// Segments keep their integer names as IDs, "*" is an empty sequence
+    /// and links of every orientation, including self-inversions, are kept
+    BidirectedGraph g;
+    if (!load(filename, g)) return 1;
+    Contents expected;
+    expected.sequences = {{1, "GATT"}, {2, "ACA"}, {3, ""}, {5, "T"}, {10, "CCGT"}};
+    for (const auto& [id, sequence] : expected.sequences) expected.lengths[id] = sequence.size();
+    vector<id_edge_t> edges = {
+        {1, false, 2, true}, {2, true, 3, false}, {3, false, 5, false},
+        {5, false, 5, true}, {10, true, 1, false}, {1, true, 1, false}
+    };
+    for (const auto& [from, from_reverse, to, to_reverse] : edges) {
+        id_edge_t complement(to, !to_reverse, from, !from_reverse);
+        expected.edges.insert(min(id_edge_t(from, from_reverse, to, to_reverse), complement));
+    }
+    if (!(get_contents(g) == expected) || g.get_edge_count() != edges.size()) {
+        cout << "Load: contents mismatch" << endl;
+        mismatches++;
+    }
+    mismatches += check_round_trip(g, LoadMode::FULL, "Round trip");
+
+    /// Without sequences the lengths are written and read as LN tags
+    BidirectedGraph lengths;
+    if (!load(filename, lengths, LoadMode::LENGTHS_ONLY)) return 1;
+    expected.sequences.clear();
+    if (!(get_contents(lengths) == expected)) {
+        cout << "Lengths only load: contents mismatch" << endl;
+        mismatches++;
+    }
+    mismatches += check_round_trip(lengths, LoadMode::LENGTHS_ONLY, "Lengths only round trip");
+
+    /// Overlapping links and named segments can't be represented
+    mismatches += check_rejected("S\t1\tGATT\nS\t2\tACA\nL\t1\t+\t2\t+\t3M\n", "Overlapping link");
+    mismatches += check_rejected("S\ts1\tGATT\n", "Named segment");
+    mismatches += check_rejected("S\t1\tGATT\nL\t1\t+\t1\tx\t0M\n", "Bad orientation");
+
+    cout << (mismatches ? "Failure" : "Success") << endl;
+    return mismatches != 0;
+}
@@ -0,0 +1,95 @@
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+#include "../../src/BidirectedGraph.hpp"
+#include "../../src/MemoryUsage.hpp"
+#include "../../src/algorithms/decompose.hpp"
+#include "../../deps/jsoncpp/dist/json/json.h"
+
+using namespace std;
+
+/// Checks that every entry of the report has a name, self bytes and parts,
+/// and that its bytes add up. Collects the names. Returns the number of
+/// mismatches.
+int check_entry(const Json::Value& entry, set<string>& names) {
+    if (!entry.isObject() || !entry["name"].isString() || !entry["bytes"].isUInt64()
+            || !entry["self"].isUInt64() || !entry["parts"].isArray()) {
+        cout << "Malformed entry: " << entry.toStyledString() << endl;
+        return 1;
+    }
+    int mismatches = 0;
+    names.insert(entry["name"].asString());
+    uint64_t total = entry["self"].asUInt64();
+    for (const auto& part : entry["parts"]) {
+        mismatches += check_entry(part, names);
+        total += part["bytes"].asUInt64();
+    }
+    if (total != entry["bytes"].asUInt64()) {
+        cout << entry["name"].asString() << ": bytes don't add up" << endl;
+        mismatches++;
+    }
+    return mismatches;
+}
+
+/// Parses a report and checks that it has every expected entry. Returns the
+/// number of mismatches.
+int check_report(const MemoryUsage& usage, const set<string>& expected, const string& name) {
+    Json::CharReaderBuilder reader;
+    Json::Value report;
+    string errs;
+    stringstream in(usage.to_json());
+    if (!Json::parseFromStream(reader, in, &report, &errs)) {
+        cout << name << ": report isn't JSON: " << errs << endl;
+        return 1;
+    }
+
+    set<string> names;
+    int mismatches = check_entry(report, names);
+    for (const auto& entry : expected) {
+        if (!names.count(entry)) {
+            cout << name << ": no entry for " << entry << endl;
+            mismatches++;
+        }
+    }
+    if (report["bytes"].asUInt64() != usage.total()) {
+        cout << name << ": total mismatch" << endl;
+        mismatches++;
+    }
+    cout << name << ": " << usage.total() << " bytes" << endl;
+    return mismatches;
+}
+
+int main(int argc, char* argv[]) {
+    string filename = argv[argc - 1];
+    ifstream json_file(filename, ifstream::binary);
+    BidirectedGraph g;
+    if (!g.deserialize(json_file)) return 1;
+    int mismatches = 0;
+
+    mismatches += check_report(g.memory_usage(), {"BidirectedGraph", "adjacency", "spilled", "arena"}, "Graph");
+
+    /// Names are escaped
+    MemoryUsage quoted("a \"quoted\\name\"", 1);
+    quoted.add("part", 2).add("subpart", 3);
+    mismatches += check_report(quoted, {"a \"quoted\\name\"", "part", "subpart"}, "Quoted");
+
+    /// Decomposition state before and after the run, next to the graph
+    DecompositionTreeBuilder builder(&g);
+    set<string> decomposition = {"BidirectedGraph", "DecompositionTreeBuilder", "decomp_map", "updates",
+        "BundleIndex", "bundle_map", "BundlePool", "idle_bundles", "DecompositionTree"};
+    auto check_run = [&](const string& stage) {
+        MemoryUsage usage("Run");
+        usage.add(g.memory_usage());
+        usage.add(builder.memory_usage());
+        return check_report(usage, decomposition, stage);
+    };
+    mismatches += check_run("Before decomposition");
+    builder.construct_tree();
+    mismatches += check_run("After decomposition");
+
+    cout << (mismatches ? "Failure" : "Success") << endl;
+    return mismatches != 0;
+}
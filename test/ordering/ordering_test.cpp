@@ -0,0 +1,158 @@
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <map>
+#include <set>
+#include <tuple>
+
+#include "../../src/BidirectedGraph.hpp"
+
+using namespace std;
+
+/// An edge as (from ID, from reverse, to ID, to reverse), written in the
+/// smaller of its two orientations
+using id_edge_t = tuple<nid_t, bool, nid_t, bool>;
+
+/// Node sequences and edges of a graph, by ID
+struct Contents {
+    map<nid_t, string> sequences;
+    set<id_edge_t> edges;
+};
+
+Contents get_contents(const BidirectedGraph& g) {
+    Contents contents;
+    g.for_each_handle([&](const handle_t& handle) {
+        contents.sequences[g.get_id(handle)] = g.get_sequence(handle);
+        for (bool is_reverse : {false, true}) {
+            handle_t side = is_reverse ? g.flip(handle) : handle;
+            g.follow_edges(side, false, [&](const handle_t& next) {
+                id_edge_t edge(g.get_id(side), g.get_is_reverse(side), g.get_id(next), g.get_is_reverse(next));
+                id_edge_t complement(g.get_id(next), !g.get_is_reverse(next), g.get_id(side), !g.get_is_reverse(side));
+                contents.edges.insert(min(edge, complement));
+            });
+        }
+    });
+    return contents;
+}
+
+/// Renames the nodes of the contents
+Contents rename(const Contents& contents, const map<nid_t, nid_t>& new_ids) {
+    Contents renamed;
+    for (const auto& [id, sequence] : contents.sequences) renamed.sequences[new_ids.at(id)] = sequence;
+    for (const auto& [from, from_reverse, to, to_reverse] : contents.edges) {
+        id_edge_t edge(new_ids.at(from), from_reverse, new_ids.at(to), to_reverse);
+        id_edge_t complement(new_ids.at(to), !to_reverse, new_ids.at(from), !from_reverse);
+        renamed.edges.insert(min(edge, complement));
+    }
+    return renamed;
+}
+
+/// Node IDs in iteration order
+vector<nid_t> get_order(const BidirectedGraph& g) {
+    vector<nid_t> order;
+    g.for_each_handle([&](const handle_t& handle) {
+        order.push_back(g.get_id(handle));
+    });
+    return order;
+}
+
+/// Checks the graph against the expected contents, node order and edge
+/// count. Returns the number of mismatches.
+int check(const BidirectedGraph& g, const Contents& expected, const vector<nid_t>& order,
+        size_t edge_count, const string& name) {
+    int mismatches = 0;
+    Contents found = get_contents(g);
+    if (found.sequences != expected.sequences) {
+        cout << name << ": sequence mismatch" << endl;
+        mismatches++;
+    }
+    if (found.edges != expected.edges || g.get_edge_count() != edge_count) {
+        cout << name << ": edge mismatch" << endl;
+        mismatches++;
+    }
+    if (get_order(g) != order) {
+        cout << name << ": order mismatch" << endl;
+        mismatches++;
+    }
+    for (const auto& [id, sequence] : expected.sequences) {
+        if (!g.has_node(id)) {
+            cout << name << ": node " << id << " missing" << endl;
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char* argv[]) {
+    string filename = argv[argc - 1];
+    ifstream json_file(filename, ifstream::binary);
+
+    BidirectedGraph g;
+    if (!g.deserialize(json_file)) return 1;
+    Contents original = get_contents(g);
+    size_t edge_count = g.get_edge_count();
+    int mismatches = 0;
+
+    /// Reverse the iteration order, asking for some nodes in reverse
+    vector<nid_t> order = get_order(g);
+    vector<handle_t> reversed;
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        reversed.push_back(g.get_handle(*it, reversed.size() % 2));
+    }
+    vector<nid_t> reversed_order(order.rbegin(), order.rend());
+    g.apply_ordering(reversed);
+    mismatches += check(g, original, reversed_order, edge_count, "Ordering");
+
+    /// Ordering with compaction numbers the nodes 1..N along the order, so
+    /// putting the first node last moves every ID
+    vector<handle_t> rotated;
+    for (size_t i = 1; i <= reversed_order.size(); i++) {
+        rotated.push_back(g.get_handle(reversed_order[i % reversed_order.size()]));
+    }
+    map<nid_t, nid_t> compact_ids;
+    vector<nid_t> compact_order;
+    for (size_t i = 0; i < rotated.size(); i++) {
+        compact_ids[g.get_id(rotated[i])] = i + 1;
+        compact_order.push_back(i + 1);
+    }
+    g.apply_ordering(rotated, true);
+    Contents compacted = rename(original, compact_ids);
+    mismatches += check(g, compacted, compact_order, edge_count, "Compacting ordering");
+    if (g.min_node_id() != 1 || g.max_node_id() != static_cast<nid_t>(rotated.size())) {
+        cout << "Compacting ordering: ID bounds mismatch" << endl;
+        mismatches++;
+    }
+
+    /// Spread the IDs out, then let optimize keep them and number them again
+    map<nid_t, nid_t> spread_ids;
+    for (const auto& id : compact_order) spread_ids[id] = 1000 - 10 * id;
+    g.reassign_node_ids([&](const nid_t& id) {
+        return spread_ids.at(id);
+    });
+    Contents spread = rename(compacted, spread_ids);
+    vector<nid_t> spread_order;
+    for (auto it = spread_ids.rbegin(); it != spread_ids.rend(); ++it) spread_order.push_back(it->second);
+    mismatches += check(g, spread, spread_order, edge_count, "Reassignment");
+
+    g.optimize(false);
+    mismatches += check(g, spread, spread_order, edge_count, "Optimize keeping IDs");
+
+    map<nid_t, nid_t> optimized_ids;
+    vector<nid_t> optimized_order;
+    for (size_t i = 0; i < spread_order.size(); i++) {
+        optimized_ids[spread_order[i]] = i + 1;
+        optimized_order.push_back(i + 1);
+    }
+    g.optimize(true);
+    mismatches += check(g, rename(spread, optimized_ids), optimized_order, edge_count, "Optimize");
+
+    /// New nodes continue after the compacted IDs
+    handle_t created = g.create_handle("GATTACA");
+    if (g.get_id(created) != static_cast<nid_t>(optimized_order.size()) + 1 || g.get_sequence(created) != "GATTACA") {
+        cout << "Optimize: new node mismatch" << endl;
+        mismatches++;
+    }
+
+    cout << (mismatches ? "Failure" : "Success") << endl;
+    return mismatches != 0;
+}
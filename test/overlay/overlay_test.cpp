@@ -0,0 +1,94 @@
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+#include "../../src/BidirectedGraph.hpp"
+#include "../../src/BidirectedGraphOverlay.hpp"
+#include "../../src/algorithms/decompose.hpp"
+
+using namespace std;
+
+/// Node sequences and edges of a graph, by ID and orientation
+struct Contents {
+    map<nid_t, string> sequences;
+    set<pair<pair<nid_t, bool>, pair<nid_t, bool>>> edges;
+    size_t edge_count = 0;
+
+    bool operator==(const Contents& other) const {
+        return sequences == other.sequences && edges == other.edges && edge_count == other.edge_count;
+    }
+};
+
+Contents get_contents(const HandleGraph& g) {
+    Contents contents;
+    g.for_each_handle([&](const handle_t& handle) {
+        contents.sequences[g.get_id(handle)] = g.get_sequence(handle);
+        for (bool is_reverse : {false, true}) {
+            handle_t side = is_reverse ? g.flip(handle) : handle;
+            g.follow_edges(side, false, [&](const handle_t& next) {
+                contents.edges.emplace(make_pair(g.get_id(side), g.get_is_reverse(side)),
+                    make_pair(g.get_id(next), g.get_is_reverse(next)));
+            });
+        }
+    });
+    contents.edge_count = g.get_edge_count();
+    return contents;
+}
+
+/// Runs the decomposition on the graph and returns the number of nodes left
+size_t decompose(DeletableHandleGraph& g) {
+    DecompositionTreeBuilder builder(&g);
+    builder.construct_tree();
+    return g.get_node_count();
+}
+
+/// Decomposes a snapshot of a graph and checks that the graph itself is left
+/// as it was
+int main(int argc, char* argv[]) {
+    string filename = argv[argc - 1];
+    ifstream json_file(filename, ifstream::binary);
+    BidirectedGraph g;
+    if (!g.deserialize(json_file)) return 1;
+    json_file.close();
+    Contents original = get_contents(g);
+    int mismatches = 0;
+
+    /// The overlay ends up where decomposing a copy of the graph does
+    json_file.open(filename, ifstream::binary);
+    BidirectedGraph copy;
+    copy.deserialize(json_file);
+    decompose(copy);
+    {
+        BidirectedGraphOverlay overlay = g.snapshot();
+        size_t count = decompose(overlay);
+        cout << "Overlay nodes: " << original.sequences.size() << " -> " << count << endl;
+        if (!(get_contents(overlay) == get_contents(copy))) {
+            cout << "Overlay decomposed to " << count << " nodes and " << overlay.get_edge_count()
+                << " edges instead of " << copy.get_node_count() << " nodes and "
+                << copy.get_edge_count() << " edges, or to other sequences or edges" << endl;
+            mismatches++;
+        }
+        if (!(get_contents(g) == original)) {
+            cout << "Base changed while the overlay was in use" << endl;
+            mismatches++;
+        }
+
+        try {
+            overlay.apply_ordering(vector<handle_t>());
+            cout << "Overlay apply_ordering didn't throw" << endl;
+            mismatches++;
+        } catch (const logic_error&) {
+        }
+    }
+    if (!(get_contents(g) == original)) {
+        cout << "Base changed after the overlay was gone" << endl;
+        mismatches++;
+    }
+
+    cout << (mismatches ? "Failure" : "Success") << endl;
+    return mismatches != 0;
+}
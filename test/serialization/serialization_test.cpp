@@ -1,11 +1,176 @@
 #include <iostream>
 #include <string>
+#include <tuple>
 #include <fstream>
+#include <sstream>
+#include <utility>
+#include <vector>
 
 #include "../../src/BidirectedGraph.hpp"
 
 using namespace std;
 
+/// Loads the graph whose IDs are written as strings, which should map to
+/// the same integer IDs as the reversed node graph. Returns the number of
+/// mismatches.
+int check_string_ids(const string& filename) {
+    ifstream json_file(filename, ifstream::binary);
+    BidirectedGraph g;
+    if (!g.deserialize(json_file)) {
+        cout << "String IDs: parse failed" << endl;
+        return 1;
+    }
+
+    int mismatches = 0;
+    vector<pair<nid_t, string>> nodes = {{1, "GATT"}, {2, "ACA"}, {3, "T"}};
+    for (const auto& [id, sequence] : nodes) {
+        if (!g.has_node(id) || g.get_sequence(g.get_handle(id)) != sequence) {
+            cout << "String IDs: node " << id << " mismatch" << endl;
+            mismatches++;
+        }
+    }
+    if (mismatches) return mismatches;
+    if (g.get_node_count() != 3 || g.get_edge_count() != 2
+            || !g.has_edge(g.get_handle(1), g.get_handle(2, true))
+            || !g.has_edge(g.get_handle(2, true), g.get_handle(3))) {
+        cout << "String IDs: edge mismatch" << endl;
+        mismatches++;
+    }
+    return mismatches;
+}
+
+/// Loads the graph with and without its sequences and checks that only
+/// the sequences (and with TOPOLOGY_ONLY the lengths) differ. Returns the
+/// number of mismatches.
+int check_load_modes(const string& filename) {
+    int mismatches = 0;
+    BidirectedGraph full;
+    ifstream full_file(filename, ifstream::binary);
+    if (!full.deserialize(full_file)) return 1;
+
+    for (LoadMode mode : {LoadMode::LENGTHS_ONLY, LoadMode::TOPOLOGY_ONLY}) {
+        string name = mode == LoadMode::LENGTHS_ONLY ? "Lengths only" : "Topology only";
+        BidirectedGraph g;
+        ifstream json_file(filename, ifstream::binary);
+        if (!g.deserialize(json_file, mode)) {
+            cout << name << ": parse failed" << endl;
+            mismatches++;
+            continue;
+        }
+        if (g.has_sequences() || g.get_node_count() != full.get_node_count()
+                || g.get_edge_count() != full.get_edge_count()) {
+            cout << name << ": sequences kept or counts mismatch" << endl;
+            mismatches++;
+        }
+        full.for_each_handle([&](const handle_t& handle) {
+            nid_t id = full.get_id(handle);
+            if (!g.has_node(id)) {
+                cout << name << ": node " << id << " missing" << endl;
+                mismatches++;
+                return;
+            }
+            size_t length = mode == LoadMode::LENGTHS_ONLY ? full.get_length(handle) : 0;
+            if (g.get_length(g.get_handle(id)) != length) {
+                cout << name << ": node " << id << " length mismatch" << endl;
+                mismatches++;
+            }
+            for (bool is_reverse : {false, true}) {
+                handle_t side = full.get_handle(id, is_reverse);
+                full.follow_edges(side, false, [&](const handle_t& next) {
+                    if (!g.has_edge(side, next)) {
+                        cout << name << ": edge from node " << id << " missing" << endl;
+                        mismatches++;
+                    }
+                });
+            }
+        });
+    }
+    return mismatches;
+}
+
+/// Builds the same small graph each time, with nodes created out of ID order
+void build_unordered_graph(BidirectedGraph& g) {
+    for (nid_t id : {5, 2, 9, 1, 7}) g.create_handle("GAT" + string(id, 'A'), id);
+    g.create_edge(g.get_handle(5), g.get_handle(2));
+    g.create_edge(g.get_handle(9), g.get_handle(1, true));
+    g.create_edge(g.get_handle(2), g.get_handle(7));
+    g.create_edge(g.get_handle(1, true), g.get_handle(5));
+    g.create_edge(g.get_handle(7), g.get_handle(7, true));
+    g.create_edge(g.get_handle(2), g.get_handle(9));
+}
+
+/// Writes the graph to the file, in storage order or by ID, or in the given
+/// order if it isn't empty, and returns what was written
+string write_graph(BidirectedGraph& g, const string& filename, bool sort_by_id,
+        const vector<handle_t>& order = {}) {
+    ofstream out_file(filename);
+    if (order.empty()) {
+        g.serialize(out_file, sort_by_id);
+    } else {
+        g.serialize(out_file, order);
+    }
+    out_file.close();
+    ifstream in_file(filename, ifstream::binary);
+    stringstream contents;
+    contents << in_file.rdbuf();
+    return contents.str();
+}
+
+/// Returns the IDs of the nodes in written vg JSON, in the order written
+vector<nid_t> written_order(const string& json) {
+    vector<nid_t> order;
+    const string key = "{\"id\": ";
+    for (size_t pos = json.find(key); pos != string::npos; pos = json.find(key, pos + 1)) {
+        order.push_back(stoll(json.substr(pos + key.size())));
+    }
+    return order;
+}
+
+/// Writes a graph by ID and in an explicit order, twice each and from two
+/// identical graphs, and checks the node order and that the output is the
+/// same every time. Returns the number of mismatches.
+int check_serialize_order() {
+    int mismatches = 0;
+    BidirectedGraph g;
+    BidirectedGraph same;
+    build_unordered_graph(g);
+    build_unordered_graph(same);
+
+    /// Orientations in the order are ignored and node 9 is listed twice;
+    /// nodes left out follow in storage order
+    vector<handle_t> order = {g.get_handle(7), g.get_handle(2, true), g.get_handle(9), g.get_handle(9, true)};
+    vector<nid_t> expected_order = {7, 2, 9};
+    g.for_each_handle([&](const handle_t& handle) {
+        if (g.get_id(handle) == 1 || g.get_id(handle) == 5) expected_order.push_back(g.get_id(handle));
+    });
+    vector<tuple<string, bool, vector<handle_t>, vector<nid_t>>> cases = {
+        {"Sorted by ID", true, {}, {1, 2, 5, 7, 9}},
+        {"Explicit order", false, order, expected_order}
+    };
+    for (const auto& [name, sort_by_id, handles, expected] : cases) {
+        string first = write_graph(g, "test_order.json", sort_by_id, handles);
+        string second = write_graph(g, "test_order.json", sort_by_id, handles);
+        string other = write_graph(same, "test_order.json", sort_by_id, handles);
+        if (written_order(first) != expected) {
+            cout << name << ": nodes written in the wrong order" << endl;
+            mismatches++;
+        }
+        if (first != second || first != other) {
+            cout << name << ": output differs between runs" << endl;
+            mismatches++;
+        }
+
+        BidirectedGraph reloaded;
+        ifstream json_file("test_order.json", ifstream::binary);
+        if (!reloaded.deserialize(json_file) || reloaded.get_node_count() != g.get_node_count()
+                || reloaded.get_edge_count() != g.get_edge_count()) {
+            cout << name << ": written graph doesn't load back" << endl;
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
 int main(int argc, char* argv[]) {
     string filename = argv[argc - 1];
     ifstream json_file(filename, ifstream::binary);
@@ -39,5 +204,19 @@ int main(int argc, char* argv[]) {
     g.serialize(out_file);
     out_file.close();
 
-    return 0;    
+    /// The string ID graph sits next to the graph given
+    size_t slash = filename.find_last_of('/');
+    string directory = slash == string::npos ? "" : filename.substr(0, slash + 1);
+    int mismatches = check_string_ids(directory + "string_id_graph.json");
+    cout << "String IDs: " << (mismatches ? "Failure" : "Success") << endl;
+
+    int mode_mismatches = check_load_modes(filename) + check_load_modes(directory + "string_id_graph.json");
+    cout << "Load modes: " << (mode_mismatches ? "Failure" : "Success") << endl;
+    mismatches += mode_mismatches;
+
+    int order_mismatches = check_serialize_order();
+    cout << "Serialization order: " << (order_mismatches ? "Failure" : "Success") << endl;
+    mismatches += order_mismatches;
+
+    return mismatches != 0;
 }
\ No newline at end of file